@@ -1,10 +1,14 @@
 #include "ss_tm.h"
+#include "ss_tm_results.h"
+#include "ss_tm_view.h"
+#include "ss_tm_soon.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
 #include <string.h>
-#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 uint64_t simulated_start_state;
 
@@ -36,25 +40,12 @@ char tape_char_to_symbol(uint64_t tape_char) {
 }
 
 uint64_t symbol_to_tape_char(char c) {
-    switch(c) {
-        case ' ':
-            return 0ull;
-        case '1':
-            return 1ull;
-        case '[':
-            return 2ull;
-        case ']':
-            return 3ull;
-        case 'a':
-            return 4ull;
-        case 'b':
-            return 5ull;
-        case 'c':
-            return 6ull;
-        default:
-            fprintf(stderr, "Unknown symbol %c\n", c);
-            exit(-1);
+    uint64_t tape_char = ss_tm_soon_symbol(c);
+    if(tape_char == SS_TM_SOON_NO_SYMBOL) {
+        fprintf(stderr, "Unknown symbol %c\n", c);
+        exit(-1);
     }
+    return tape_char;
 }
 
 char *state_int_to_str(uint64_t state) {
@@ -91,209 +82,7 @@ char *tape_contents_to_string(uint64_t *tape, size_t tape_size) {
 }
 
 void add_needed_transitions_for_simulation(struct ss_tm *tm) {
-    struct ss_tm_transition trans;
-    // States necessary to simulate the SOON-TM:
-    // s_0: start state. Shift tape head by one and go to the simulated start 
-    //  state. Needed because we start all strings with "beginning of tape" 
-    //  symbol.
-    // s_1: If we reached beginning of tape symbol.
-    // s_2: If we're shifting all characters to the left, and the last character 
-    // was a 
-
-    // Since we construct our input to begin with the special beginning-of-tape 
-    // symbol, we shift over one space before we begin simulating the SOON-TM.
-    trans.in_state = SS_TM_INITIAL_STATE;
-    trans.in_char = symbol_to_tape_char('[');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char('[');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Shift all input to the right by one, then return to the beginning, if we 
-    // are at the beginning-of-tape character. Need a state to catch this for 
-    // each of the normal states, except the halt state.
-    uint64_t shift_right_states_start = SS_TM_INITIAL_STATE + 100;
-
-    // Make sure to save our original state (one of the three simulated states, 
-    // a, b, or c.
-    trans.in_state = simulated_start_state;
-    trans.in_char = symbol_to_tape_char('[');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.out_char = symbol_to_tape_char('a');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = simulated_start_state + 1;
-    trans.in_char = symbol_to_tape_char('[');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.out_char = symbol_to_tape_char('b');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = simulated_start_state + 2;
-    trans.in_char = symbol_to_tape_char('[');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.out_char = symbol_to_tape_char('c');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Moving right and we've saved a "["
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('[');
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(']');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Moving right and we've saved a " "
-    trans.in_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(']');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Moving right and we've saved a "1"
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(' ');
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + symbol_to_tape_char('1');
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = shift_right_states_start + symbol_to_tape_char(']');
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Moving right and we've saved a "]"
-    // Stop moving right. Now we need to return to the saved state.
-    trans.in_state = shift_right_states_start + symbol_to_tape_char(']');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = shift_right_states_start + 50;
-    trans.out_char = symbol_to_tape_char(']');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
-
-    // We've shifted everything to the right one character, now we are returning 
-    // to the saved state.
-    trans.in_state = shift_right_states_start + 50;
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = shift_right_states_start + 50;
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + 50;
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = shift_right_states_start + 50;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + 50;
-    trans.in_char = symbol_to_tape_char('a');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char('[');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + 50;
-    trans.in_char = symbol_to_tape_char('b');
-    trans.out_state = simulated_start_state + 1;
-    trans.out_char = symbol_to_tape_char('[');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = shift_right_states_start + 50;
-    trans.in_char = symbol_to_tape_char('c');
-    trans.out_state = simulated_start_state + 2;
-    trans.out_char = symbol_to_tape_char('[');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    // Now, similar if we need to shift the right bound character "]" over by 
-    // one.
-    uint64_t new_char_on_left_start_state = SS_TM_INITIAL_STATE + 200;
-
-    trans.in_state = simulated_start_state;
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = new_char_on_left_start_state + symbol_to_tape_char('a');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = simulated_start_state + 1;
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = new_char_on_left_start_state + symbol_to_tape_char('b');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = simulated_start_state + 2;
-    trans.in_char = symbol_to_tape_char(']');
-    trans.out_state = new_char_on_left_start_state + symbol_to_tape_char('c');
-    trans.out_char = symbol_to_tape_char(' ');
-    trans.out_right = true;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = new_char_on_left_start_state + symbol_to_tape_char('a');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char(']');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = new_char_on_left_start_state + symbol_to_tape_char('b');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state + 1;
-    trans.out_char = symbol_to_tape_char(']');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
-
-    trans.in_state = new_char_on_left_start_state + symbol_to_tape_char('c');
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state + 2;
-    trans.out_char = symbol_to_tape_char(']');
-    trans.out_right = false;
-    ss_tm_add_state_transition(tm, trans);
+    ss_tm_soon_add_emulation(tm, simulated_start_state);
 }
 
 void print_state(struct ss_tm *tm, FILE *f) {
@@ -327,7 +116,11 @@ void print_simulation_progress(struct ss_tm *tm, uint64_t num_steps, FILE *f) {
         uint64_t state;
         if(ss_tm_peek_state(tm, &state) == SS_TM_REJECT_STATE)
             return;
-        ss_tm_simulation_step(tm);
+        // Past a halt the state just repeats; any other error would repeat
+        // forever.
+        enum ss_tm_err e = ss_tm_simulation_step(tm);
+        if(e != SS_TM_ERR_NO_ERROR && e != SS_TM_ERR_STEP_ON_HALTED_MACHINE)
+            return;
         ss_tm_peek_state(tm, &state);
         if(state == simulated_start_state ||
             state == simulated_start_state + 1 ||
@@ -343,13 +136,28 @@ void print_simulation_progress(struct ss_tm *tm, uint64_t num_steps, FILE *f) {
 // This function assumes that it's in a simulated state (q_0, q_1, q_2, q_R)
 void verify_state(struct ss_tm *tm, bool *contains_a_6, bool *contains_no_7s) {
 
-        uint64_t *tape;
-        size_t tape_size;
-        ss_tm_peek_tape_all(tm, &tape, &tape_size);
-        char *tape_str = tape_contents_to_string(tape, tape_size);
-        *contains_a_6 = strstr(tape_str, "111111") != NULL;
-        *contains_no_7s = strstr(tape_str, "1111111") == NULL;
-        free(tape_str);
+        // Find the longest run of 1s without copying the tape.
+        struct ss_tm_tape_view view;
+        ss_tm_view_begin(&view, tm);
+        uint64_t one = symbol_to_tape_char('1');
+        size_t run = 0;
+        size_t longest_run = 0;
+        const uint64_t *cells;
+        size_t num_cells;
+        size_t position;
+        for(position = 0;
+            ss_tm_view_chunk(&view, position, 4096, &cells, &num_cells) == SS_TM_ERR_NO_ERROR;
+            position += num_cells) {
+
+            size_t i;
+            for(i = 0; i < num_cells; i++) {
+                run = cells[i] == one ? run + 1 : 0;
+                if(run > longest_run)
+                    longest_run = run;
+            }
+        }
+        *contains_a_6 = longest_run >= 6;
+        *contains_no_7s = longest_run < 7;
 }
 
 bool verify_simulation_progress(struct ss_tm *tm, uint64_t num_steps) {
@@ -358,9 +166,14 @@ bool verify_simulation_progress(struct ss_tm *tm, uint64_t num_steps) {
     uint64_t i;
     for(i = 0; i < num_steps; i++) {
         uint64_t state;
-        if(ss_tm_peek_state(tm, &state) == SS_TM_REJECT_STATE)
+        ss_tm_peek_state(tm, &state);
+        if(state == SS_TM_REJECT_STATE)
             return there_exists_a_6 && forall_states_no_7s;
-        ss_tm_simulation_step(tm);
+        // A candidate whose tape runs away, or whose head falls off the left
+        // end, can't be a match. The step leaves the state as it was, so
+        // carrying on would only repeat it.
+        if(ss_tm_simulation_step(tm) != SS_TM_ERR_NO_ERROR)
+            return false;
         ss_tm_peek_state(tm, &state);
         if(state == simulated_start_state ||
             state == simulated_start_state + 1 ||
@@ -379,135 +192,314 @@ bool verify_simulation_progress(struct ss_tm *tm, uint64_t num_steps) {
     return there_exists_a_6 && forall_states_no_7s;
 }
 
-void run_finder() {
-
-    uint64_t states[4];
-    states[0] = simulated_start_state;
-    states[1] = simulated_start_state + 1;
-    states[2] = simulated_start_state + 2;
-    states[3] = SS_TM_REJECT_STATE;
-
-    char chars[2] = {' ', '1'};
-
-    bool output_dirs[2] = {false, true};
-
-    // Icky brute force
-
-    int a_blank_output_char;
-    int a_blank_output_state;
-    int a_blank_output_dir;
-    int a_1_output_char;
-    int a_1_output_state;
-    int a_1_output_dir;
-    int b_blank_output_char;
-    int b_blank_output_state;
-    int b_blank_output_dir;
-    int b_1_output_char;
-    int b_1_output_state;
-    int b_1_output_dir;
-    int c_blank_output_char;
-    int c_blank_output_state;
-    int c_blank_output_dir;
-    int c_1_output_char;
-    int c_1_output_state;
-    int c_1_output_dir;
-
-    uint64_t int_progress = 0;
-    double frac_progress = 0.0;
-    double prev_frac_progress = 0.0;
-    double num_configs = pow(4.0 * 2.0 * 2.0, 6.0);
+// The finder enumerates every assignment of outputs to the six transitions of 
+// the simulated machine, (q_0, ' '), (q_0, '1'), (q_1, ' '), (q_1, '1'), 
+// (q_2, ' '), and (q_2, '1'). Each transition has 2 output chars * 4 output 
+// states * 2 directions = 16 choices, so there are 16^6 candidates in all, 
+// addressed by a linear index so that ranges of them can be handed out.
+#define FINDER_NUM_TRANSITIONS 6
+#define FINDER_NUM_CANDIDATES (1ull << (4 * FINDER_NUM_TRANSITIONS))
+
+// Save progress to the checkpoint after this many candidates.
+#define FINDER_CHECKPOINT_INTERVAL (1ull << 16)
+// First line of a checkpoint file. The number is the format's version.
+#define FINDER_CHECKPOINT_HEADER "ss_tm finder checkpoint 2\n"
+
+// Most cells a candidate's tape may grow to. Candidates that get anywhere 
+// near it are runaways, and are dropped rather than allowed to exhaust 
+// memory.
+#define FINDER_MAX_TAPE_CELLS (1ull << 20)
+
+struct finder_candidate {
+    // Indexed like the transitions above. Each is an index into the 
+    // corresponding finder_* table below.
+    int output_char[FINDER_NUM_TRANSITIONS];
+    int output_state[FINDER_NUM_TRANSITIONS];
+    int output_dir[FINDER_NUM_TRANSITIONS];
+};
+
+struct finder_checkpoint {
+    uint64_t range_begin;
+    uint64_t range_end;
+    // Every candidate in range_begin..next_candidate has been checked.
+    uint64_t next_candidate;
+    // Number of records in the results log that belong to the checked 
+    // candidates.
+    uint64_t num_results;
+};
+
+uint64_t finder_states[4];
+char finder_chars[2] = {' ', '1'};
+bool finder_output_dirs[2] = {false, true};
+
+void init_finder_states() {
+    finder_states[0] = simulated_start_state;
+    finder_states[1] = simulated_start_state + 1;
+    finder_states[2] = simulated_start_state + 2;
+    finder_states[3] = SS_TM_REJECT_STATE;
+}
 
-    for(c_blank_output_char = 0; c_blank_output_char < 2; c_blank_output_char++) {
+void decode_candidate(uint64_t candidate_index, struct finder_candidate *out) {
+    // Candidates are numbered in the order the finder used to visit them with 
+    // nested loops: (q_0, '1') varies fastest, then (q_0, ' '), (q_1, '1'), 
+    // and so on. Within a transition, the direction varies fastest, then the 
+    // state, then the char.
+    static const int transition_order[FINDER_NUM_TRANSITIONS] = {1, 0, 3, 2, 5, 4};
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++) {
+        int t = transition_order[i];
+        out->output_dir[t] = candidate_index % 2;
+        candidate_index /= 2;
+        out->output_state[t] = candidate_index % 4;
+        candidate_index /= 4;
+        out->output_char[t] = candidate_index % 2;
+        candidate_index /= 2;
+    }
+}
 
-    for(c_blank_output_state = 0; c_blank_output_state < 4; c_blank_output_state++) {
+// One byte per transition: char << 3 | state << 1 | dir.
+void pack_candidate(struct finder_candidate *c, uint8_t *out) {
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++)
+        out[i] = c->output_char[i] << 3 | c->output_state[i] << 1 | c->output_dir[i];
+}
 
-    for(c_blank_output_dir = 0; c_blank_output_dir < 2; c_blank_output_dir++) {
+void unpack_candidate(const uint8_t *packed, struct finder_candidate *out) {
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++) {
+        out->output_char[i] = (packed[i] >> 3) & 1;
+        out->output_state[i] = (packed[i] >> 1) & 3;
+        out->output_dir[i] = packed[i] & 1;
+    }
+}
 
-    for(c_1_output_char = 0; c_1_output_char < 2; c_1_output_char++) {
+void add_candidate_transitions(struct ss_tm *tm, struct finder_candidate *c) {
+    struct ss_tm_transition trans;
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++) {
+        trans.in_state = simulated_start_state + i / 2;
+        trans.in_char = symbol_to_tape_char(i % 2 ? '1' : ' ');
+        trans.out_state = finder_states[c->output_state[i]];
+        trans.out_char = symbol_to_tape_char(finder_chars[c->output_char[i]]);
+        trans.out_right = finder_output_dirs[c->output_dir[i]];
+        ss_tm_add_state_transition(tm, trans);
+    }
+}
 
-    for(c_1_output_state = 0; c_1_output_state < 4; c_1_output_state++) {
+static const char *finder_transition_names[FINDER_NUM_TRANSITIONS] = {
+    "(q_0, ' ')", "(q_0, '1')",
+    "(q_1, ' ')", "(q_1, '1')",
+    "(q_2, ' ')", "(q_2, '1')"
+};
+
+// The name a match's report used to be saved under.
+void match_report_name(struct finder_candidate *c, char *out, size_t out_size) {
+    size_t out_end = 0;
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++) {
+        out_end += snprintf(
+            out + out_end,
+            out_size - out_end,
+            "%s%s->(%s, %c, %s)",
+            i ? "_" : "",
+            finder_transition_names[i],
+            state_int_to_str(finder_states[c->output_state[i]]),
+            finder_chars[c->output_char[i]],
+            boolean_to_left_right(finder_output_dirs[c->output_dir[i]]));
+    }
+    snprintf(out + out_end, out_size - out_end, ".txt");
+}
 
-    for(c_1_output_dir = 0; c_1_output_dir < 2; c_1_output_dir++) {
+// Re-simulates a matching candidate and writes its human-readable report.
+void write_match_report(struct finder_candidate *c, FILE *to_write) {
+    struct ss_tm tm;
+    ss_tm_init_begin(&tm);
+    add_needed_transitions_for_simulation(&tm);
+    add_candidate_transitions(&tm, c);
+    ss_tm_init_end(&tm);
 
-    for(b_blank_output_char = 0; b_blank_output_char < 2; b_blank_output_char++) {
+    uint64_t input_string[2];
+    input_string[0] = symbol_to_tape_char('[');
+    input_string[1] = symbol_to_tape_char(']');
+    ss_tm_simulation_begin(&tm, input_string, 2);
+    verify_simulation_progress(&tm, 512);
 
-    for(b_blank_output_state = 0; b_blank_output_state < 4; b_blank_output_state++) {
+    fprintf(to_write, "Possible match.\n");
 
-    for(b_blank_output_dir = 0; b_blank_output_dir < 2; b_blank_output_dir++) {
+    uint64_t *tape;
+    size_t tape_size;
+    ss_tm_peek_tape_all(&tm, &tape, &tape_size);
+    char *tape_str = tape_contents_to_string(tape, tape_size);
+    fprintf(to_write, "%s\n", tape_str);
+    free(tape_str);
+
+    ss_tm_simulation_begin(&tm, input_string, 2);
+    print_simulation_progress(&tm, 512, to_write);
+
+    int i;
+    for(i = 0; i < FINDER_NUM_TRANSITIONS; i++) {
+        fprintf(to_write, "delta%s -> (%s, '%c', %s)\n",
+            finder_transition_names[i],
+            state_int_to_str(finder_states[c->output_state[i]]),
+            finder_chars[c->output_char[i]],
+            boolean_to_left_right(finder_output_dirs[c->output_dir[i]]));
+    }
 
-    for(b_1_output_char = 0; b_1_output_char < 2; b_1_output_char++) {
+    ss_tm_destroy(&tm);
+}
 
-    for(b_1_output_state = 0; b_1_output_state < 4; b_1_output_state++) {
+// Returns false if there's no checkpoint at path, or it's malformed, in 
+// which case checkpoint is left as it was. Exits if path holds something 
+// other than a checkpoint of this version, or one for another range, rather 
+// than have it overwritten.
+bool load_finder_checkpoint(const char *path, struct finder_checkpoint *checkpoint) {
+    FILE *f = fopen(path, "r");
+    if(!f)
+        return false;
+
+    // fscanf can't tell whether literal text matched, so the header is 
+    // compared whole.
+    char header[64];
+    if(!fgets(header, sizeof(header), f) || strcmp(header, FINDER_CHECKPOINT_HEADER) != 0) {
+        fprintf(stderr, "%s isn't a finder checkpoint of this version; expected it to "
+            "begin with \"%.*s\".\n", path,
+            (int)strlen(FINDER_CHECKPOINT_HEADER) - 1, FINDER_CHECKPOINT_HEADER);
+        exit(-1);
+    }
 
-    for(b_1_output_dir = 0; b_1_output_dir < 2; b_1_output_dir++) {
+    uint64_t range_begin;
+    uint64_t range_end;
+    uint64_t next_candidate;
+    uint64_t num_results;
+    if(fscanf(f, "range %" SCNu64 " %" SCNu64 "\n", &range_begin, &range_end) != 2 ||
+        fscanf(f, "next %" SCNu64 "\n", &next_candidate) != 1 ||
+        fscanf(f, "results %" SCNu64 "\n", &num_results) != 1) {
+
+        fprintf(stderr, "Ignoring malformed checkpoint %s\n", path);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    if(range_begin != checkpoint->range_begin || range_end != checkpoint->range_end) {
+        fprintf(stderr, "Checkpoint %s is for candidates %" PRIu64 "..%" PRIu64
+            ", not %" PRIu64 "..%" PRIu64 ".\n",
+            path, range_begin, range_end,
+            checkpoint->range_begin, checkpoint->range_end);
+        exit(-1);
+    }
+    checkpoint->next_candidate = next_candidate;
+    checkpoint->num_results = num_results;
+    return true;
+}
+
+// Replaces the checkpoint at path atomically: the new contents are written 
+// and fsync'd to a temporary file, which is then renamed over the old one.
+void save_finder_checkpoint(const char *path, struct finder_checkpoint *checkpoint) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if(!f) {
+        fprintf(stderr, "Couldn't write checkpoint %s\n", tmp_path);
+        exit(-1);
+    }
+    fputs(FINDER_CHECKPOINT_HEADER, f);
+    fprintf(f, "range %" PRIu64 " %" PRIu64 "\n",
+        checkpoint->range_begin, checkpoint->range_end);
+    fprintf(f, "next %" PRIu64 "\n", checkpoint->next_candidate);
+    fprintf(f, "results %" PRIu64 "\n", checkpoint->num_results);
+    if(fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        fprintf(stderr, "Couldn't write checkpoint %s\n", tmp_path);
+        exit(-1);
+    }
+    fclose(f);
+    if(rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Couldn't replace checkpoint %s\n", path);
+        exit(-1);
+    }
+
+    // Make the rename itself durable.
+    char dir_path[4096];
+    snprintf(dir_path, sizeof(dir_path), "%s", path);
+    char *slash = strrchr(dir_path, '/');
+    if(slash)
+        *slash = '\0';
+    else
+        snprintf(dir_path, sizeof(dir_path), ".");
+    int dir_fd = open(dir_path, O_RDONLY);
+    if(dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+}
 
-    for(a_blank_output_char = 0; a_blank_output_char < 2; a_blank_output_char++) {
+// Records are durable before the checkpoint that counts them, so a crash 
+// between the two only leaves records that the resumed run discards.
+void checkpoint_finder(const char *checkpoint_path, struct finder_checkpoint *checkpoint,
+    struct ss_tm_results_sink *results) {
 
-    for(a_blank_output_state = 0; a_blank_output_state < 4; a_blank_output_state++) {
+    enum ss_tm_err e = ss_tm_results_flush(results, &checkpoint->num_results);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        fprintf(stderr, "%s\n", ss_tm_err_str[e]);
+        exit(-1);
+    }
+    save_finder_checkpoint(checkpoint_path, checkpoint);
+}
 
-    for(a_blank_output_dir = 0; a_blank_output_dir < 2; a_blank_output_dir++) {
+// Checks candidates shard_index * N / num_shards up to 
+// (shard_index + 1) * N / num_shards, where N is the total number of 
+// candidates, appending a record for each match to the log at results_path. 
+// If checkpoint_path names an existing checkpoint for the same range, the run 
+// resumes where it left off.
+void run_finder(uint64_t shard_index, uint64_t num_shards, const char *checkpoint_path,
+    const char *results_path) {
+
+    init_finder_states();
+
+    struct finder_checkpoint checkpoint;
+    checkpoint.range_begin = FINDER_NUM_CANDIDATES / num_shards * shard_index +
+        FINDER_NUM_CANDIDATES % num_shards * shard_index / num_shards;
+    checkpoint.range_end = FINDER_NUM_CANDIDATES / num_shards * (shard_index + 1) +
+        FINDER_NUM_CANDIDATES % num_shards * (shard_index + 1) / num_shards;
+    checkpoint.next_candidate = checkpoint.range_begin;
+    checkpoint.num_results = 0;
+
+    if(load_finder_checkpoint(checkpoint_path, &checkpoint)) {
+        printf("Resuming at candidate %" PRIu64 " of %" PRIu64 "..%" PRIu64 "\n",
+            checkpoint.next_candidate, checkpoint.range_begin, checkpoint.range_end);
+    }
 
-    for(a_1_output_char = 0; a_1_output_char < 2; a_1_output_char++) {
+    struct ss_tm_results_sink results;
+    enum ss_tm_err e = ss_tm_results_open(&results, results_path,
+        checkpoint.num_results, NULL);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        fprintf(stderr, "%s: %s\n", results_path, ss_tm_err_str[e]);
+        exit(-1);
+    }
 
-    for(a_1_output_state = 0; a_1_output_state < 4; a_1_output_state++) {
+    double num_configs = (double)(checkpoint.range_end - checkpoint.range_begin);
+    double frac_progress = 0.0;
+    double prev_frac_progress = 0.0;
 
-    for(a_1_output_dir = 0; a_1_output_dir < 2; a_1_output_dir++) {
+    uint64_t candidate_index;
+    for(candidate_index = checkpoint.next_candidate;
+        candidate_index < checkpoint.range_end;
+        candidate_index++) {
 
         prev_frac_progress = frac_progress;
-        frac_progress = (int_progress / num_configs) * 100.0;
+        frac_progress = ((candidate_index - checkpoint.range_begin) / num_configs) * 100.0;
         if((int)prev_frac_progress != (int)frac_progress) {
             printf("Progress: %2.2f%%\n", frac_progress);
         }
-    
+
+        struct finder_candidate candidate;
+        decode_candidate(candidate_index, &candidate);
+
         struct ss_tm tm;
         ss_tm_init_begin(&tm);
         add_needed_transitions_for_simulation(&tm);
-
-        struct ss_tm_transition trans;
-
-        trans.in_state = simulated_start_state;
-        trans.in_char = symbol_to_tape_char(' ');
-        trans.out_state = states[a_blank_output_state];
-        trans.out_char = symbol_to_tape_char(chars[a_blank_output_char]);
-        trans.out_right = output_dirs[a_blank_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
-        trans.in_state = simulated_start_state;
-        trans.in_char = symbol_to_tape_char('1');
-        trans.out_state = states[a_1_output_state];
-        trans.out_char = symbol_to_tape_char(chars[a_1_output_char]);
-        trans.out_right = output_dirs[a_1_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
-        trans.in_state = simulated_start_state + 1;
-        trans.in_char = symbol_to_tape_char(' ');
-        trans.out_state = states[b_blank_output_state];
-        trans.out_char = symbol_to_tape_char(chars[b_blank_output_char]);
-        trans.out_right = output_dirs[b_blank_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
-        trans.in_state = simulated_start_state + 1;
-        trans.in_char = symbol_to_tape_char('1');
-        trans.out_state = states[b_1_output_state];
-        trans.out_char = symbol_to_tape_char(chars[b_1_output_char]);
-        trans.out_right = output_dirs[b_1_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
-        trans.in_state = simulated_start_state + 2;
-        trans.in_char = symbol_to_tape_char(' ');
-        trans.out_state = states[c_blank_output_state];
-        trans.out_char = symbol_to_tape_char(chars[c_blank_output_char]);
-        trans.out_right = output_dirs[c_blank_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
-        trans.in_state = simulated_start_state + 2;
-        trans.in_char = symbol_to_tape_char('1');
-        trans.out_state = states[c_1_output_state];
-        trans.out_char = symbol_to_tape_char(chars[c_1_output_char]);
-        trans.out_right = output_dirs[c_1_output_dir];
-        ss_tm_add_state_transition(&tm, trans);
-
+        add_candidate_transitions(&tm, &candidate);
         ss_tm_init_end(&tm);
+        ss_tm_set_space_limits(&tm, FINDER_MAX_TAPE_CELLS, NULL);
 
         uint64_t input_string[2];
         input_string[0] = symbol_to_tape_char('[');
@@ -515,112 +507,55 @@ void run_finder() {
         ss_tm_simulation_begin(&tm, input_string, 2);
         bool good = verify_simulation_progress(&tm, 512);
         if(good) {
-            char filename[512];
-            snprintf(
-                filename,
-                512,
-                "(q_0, ' ')->(%s, %c, %s)_(q_0, '1')->(%s, %c, %s)_"
-                "(q_1, ' ')->(%s, %c, %s)_(q_1, '1')->(%s, %c, %s)_"
-                "(q_2, ' ')->(%s, %c, %s)_(q_2, '1')->(%s, %c, %s).txt",
-                state_int_to_str(states[a_blank_output_state]),
-                chars[a_blank_output_char],
-                boolean_to_left_right(output_dirs[a_blank_output_dir]),
-                state_int_to_str(states[a_1_output_state]),
-                chars[a_1_output_char],
-                boolean_to_left_right(output_dirs[a_1_output_dir]),
-                state_int_to_str(states[b_blank_output_state]),
-                chars[b_blank_output_char],
-                boolean_to_left_right(output_dirs[b_blank_output_dir]),
-                state_int_to_str(states[b_1_output_state]),
-                chars[b_1_output_char],
-                boolean_to_left_right(output_dirs[b_1_output_dir]),
-                state_int_to_str(states[c_blank_output_state]),
-                chars[c_blank_output_char],
-                boolean_to_left_right(output_dirs[c_blank_output_dir]),
-                state_int_to_str(states[c_1_output_state]),
-                chars[c_1_output_char],
-                boolean_to_left_right(output_dirs[c_1_output_dir])
-            );
-            FILE *to_write = fopen(filename, "w");
-            
-            fprintf(to_write, "Possible match.\n");
-
-            uint64_t *tape;
-            size_t tape_size;
-            ss_tm_peek_tape_all(&tm, &tape, &tape_size);
-            char *tape_str = tape_contents_to_string(tape, tape_size);
-            fprintf(to_write, "%s\n", tape_str);
-            free(tape_str);
-
-            ss_tm_simulation_begin(&tm, input_string, 2);
-            print_simulation_progress(&tm, 512, to_write);
-
-            fprintf(to_write, "delta(q_0, ' ') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[a_blank_output_state]),
-                chars[a_blank_output_char],
-                boolean_to_left_right(output_dirs[a_blank_output_dir]));
-            fprintf(to_write, "delta(q_0, '1') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[a_1_output_state]),
-                chars[a_1_output_char],
-                boolean_to_left_right(output_dirs[a_1_output_dir]));
-            fprintf(to_write, "delta(q_1, ' ') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[b_blank_output_state]),
-                chars[b_blank_output_char],
-                boolean_to_left_right(output_dirs[b_blank_output_dir]));
-            fprintf(to_write, "delta(q_1, '1') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[b_1_output_state]),
-                chars[b_1_output_char],
-                boolean_to_left_right(output_dirs[b_1_output_dir]));
-            fprintf(to_write, "delta(q_2, ' ') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[c_blank_output_state]),
-                chars[c_blank_output_char],
-                boolean_to_left_right(output_dirs[c_blank_output_dir]));
-            fprintf(to_write, "delta(q_2, '1') -> (%s, '%c', %s)\n",
-                state_int_to_str(states[c_1_output_state]),
-                chars[c_1_output_char],
-                boolean_to_left_right(output_dirs[c_1_output_dir]));
-
-            fclose(to_write);
+            struct ss_tm_results_record record;
+            memset(&record, 0, sizeof(record));
+            record.candidate_index = candidate_index;
+            pack_candidate(&candidate, record.packed_table);
+            ss_tm_results_summarize(&tm, &record);
+            e = ss_tm_results_append(&results, &record);
+            if(e != SS_TM_ERR_NO_ERROR) {
+                fprintf(stderr, "%s: %s\n", results_path, ss_tm_err_str[e]);
+                exit(-1);
+            }
         }
 
-        int_progress++;
-
         ss_tm_destroy(&tm);
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
-
-    }
 
+        if((candidate_index + 1 - checkpoint.range_begin) % FINDER_CHECKPOINT_INTERVAL == 0) {
+            checkpoint.next_candidate = candidate_index + 1;
+            checkpoint_finder(checkpoint_path, &checkpoint, &results);
+        }
     }
 
-    }
+    checkpoint.next_candidate = checkpoint.range_end;
+    checkpoint_finder(checkpoint_path, &checkpoint, &results);
+    ss_tm_results_close(&results);
+    printf("Done. %" PRIu64 " matches in candidates %" PRIu64 "..%" PRIu64 "\n",
+        checkpoint.num_results, checkpoint.range_begin, checkpoint.range_end);
+}
 
-    }
-
-    }
+// Renders the records of a finder results log in the format of the old 
+// per-match report files, each preceded by the name that file had.
+void read_finder_results(const char *results_path) {
+    init_finder_states();
 
+    struct ss_tm_results_reader reader;
+    enum ss_tm_err e = ss_tm_results_reader_open(&reader, results_path);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        fprintf(stderr, "%s: %s\n", results_path, ss_tm_err_str[e]);
+        exit(-1);
     }
 
+    struct ss_tm_results_record record;
+    while(ss_tm_results_reader_next(&reader, &record)) {
+        struct finder_candidate candidate;
+        unpack_candidate(record.packed_table, &candidate);
+        char name[512];
+        match_report_name(&candidate, name, sizeof(name));
+        printf("== %s (candidate %" PRIu64 ") ==\n", name, record.candidate_index);
+        write_match_report(&candidate, stdout);
     }
+    ss_tm_results_reader_close(&reader);
 }
 
 void run_verifier() {
@@ -628,50 +563,7 @@ void run_verifier() {
     struct ss_tm tm;
     ss_tm_init_begin(&tm);
     add_needed_transitions_for_simulation(&tm);
-
-    struct ss_tm_transition trans;
-
-    trans.in_state = simulated_start_state;
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state + 1;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = false;
-    ss_tm_add_state_transition(&tm, trans);
-
-    trans.in_state = simulated_start_state;
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = simulated_start_state + 2;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = false;
-    ss_tm_add_state_transition(&tm, trans);
-
-    trans.in_state = simulated_start_state + 1;
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state + 2;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = true;
-    ss_tm_add_state_transition(&tm, trans);
-
-    trans.in_state = simulated_start_state + 1;
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = false;
-    ss_tm_add_state_transition(&tm, trans);
-
-    trans.in_state = simulated_start_state + 2;
-    trans.in_char = symbol_to_tape_char(' ');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = false;
-    ss_tm_add_state_transition(&tm, trans);
-
-    trans.in_state = simulated_start_state + 2;
-    trans.in_char = symbol_to_tape_char('1');
-    trans.out_state = simulated_start_state;
-    trans.out_char = symbol_to_tape_char('1');
-    trans.out_right = true;
-    ss_tm_add_state_transition(&tm, trans);
+    ss_tm_soon_add_verified_machine(&tm, simulated_start_state);
 
     ss_tm_init_end(&tm);
 
@@ -683,8 +575,67 @@ void run_verifier() {
     ss_tm_destroy(&tm);
 }
 
+// Usage:
+//   example
+//       Prints the verifier's simulation.
+//   example --finder [--shard i/n] [--checkpoint path] [--results path]
+//       Searches for matching machines. With --shard, only the i'th of n 
+//       equal slices of the candidates (0 <= i < n) is searched, so 
+//       independent processes can split the work. Matches are appended to the 
+//       results log (finder_<i>_of_<n>.results by default). Progress is saved 
+//       to the checkpoint (finder_<i>_of_<n>.checkpoint by default), and 
+//       rerunning the same command resumes from it.
+//   example --read-results path
+//       Prints the report of every match in a results log.
 int main(int argc, char *argv[]) {
     simulated_start_state = SS_TM_INITIAL_STATE + 1000;
-    //run_finder();
-    run_verifier();
+
+    bool finder = false;
+    uint64_t shard_index = 0;
+    uint64_t num_shards = 1;
+    const char *checkpoint_path = NULL;
+    const char *results_path = NULL;
+    const char *read_results_path = NULL;
+    int i;
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--finder") == 0) {
+            finder = true;
+        } else if(strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if(sscanf(argv[++i], "%" SCNu64 "/%" SCNu64, &shard_index, &num_shards) != 2 ||
+                num_shards == 0 || shard_index >= num_shards) {
+
+                fprintf(stderr, "--shard expects i/n with 0 <= i < n\n");
+                return -1;
+            }
+        } else if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if(strcmp(argv[i], "--results") == 0 && i + 1 < argc) {
+            results_path = argv[++i];
+        } else if(strcmp(argv[i], "--read-results") == 0 && i + 1 < argc) {
+            read_results_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if(read_results_path) {
+        read_finder_results(read_results_path);
+    } else if(finder) {
+        char default_checkpoint_path[64];
+        if(!checkpoint_path) {
+            snprintf(default_checkpoint_path, sizeof(default_checkpoint_path),
+                "finder_%" PRIu64 "_of_%" PRIu64 ".checkpoint", shard_index, num_shards);
+            checkpoint_path = default_checkpoint_path;
+        }
+        char default_results_path[64];
+        if(!results_path) {
+            snprintf(default_results_path, sizeof(default_results_path),
+                "finder_%" PRIu64 "_of_%" PRIu64 ".results", shard_index, num_shards);
+            results_path = default_results_path;
+        }
+        run_finder(shard_index, num_shards, checkpoint_path, results_path);
+    } else {
+        run_verifier();
+    }
 }
\ No newline at end of file
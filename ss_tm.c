@@ -1,8 +1,175 @@
 #include "ss_tm.h"
+#include "ss_tm_index.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef SS_TM_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#define SS_TM_STAT(stmt) do { stmt; } while(0)
+#else
+#define SS_TM_STAT(stmt) do { } while(0)
+#endif
+
+char *ss_tm_err_str[] = {
+    "ss_tm: no error",
+    "ss_tm: memory allocation failed",
+    "ss_tm: The inputs of the given transition matched the inputs of an already"
+        "of a transition already in the transition map.",
+    "ss_tm: The machine has already been initialized. (You're probably trying "
+        "to perform an action that can only be done in initialization.)",
+    "ss_tm: The input string contained an invalid character. Recall that "
+        "input characters must be in the range 1..(max(uint64_t)/2)",
+    "ss_tm: The simulation hasn't been started. (You're probably trying to "
+        "perform an action that can only be done after a simulation has been "
+        "started.)",
+    "ss_tm: The machine has halted, but you attempted to perform a simulation "
+        "step.",
+    "ss_tm: Caller's TM is malformed. Attempted to move the head to the left "
+        "when already on the left-most cell.",
+    "ss_tm: The machine hasn't been initialized. (You're probably trying to "
+        "perform an action that can only be done after ss_tm_init_end.)",
+    "ss_tm: Failed to start a worker thread.",
+    "ss_tm: The tape would exceed the configured memory limit.",
+    "ss_tm: A file operation failed. (Check errno for the reason.)",
+    "ss_tm: The file isn't in the expected format.",
+    "ss_tm: The requested position is outside the available range.",
+    "ss_tm: Statistics weren't compiled in. (Define SS_TM_STATS.)",
+    "ss_tm: The tape was reallocated or the simulation restarted since the view was made.",
+    "ss_tm: Nondeterministic machines can't be simulated step by step."
+};
+
+#ifdef SS_TM_STATS
+    static inline uint64_t
+ss_tm_stats_cycles(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    // No portable cycle counter, so fall back to nanoseconds.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+    static enum ss_tm_err
+ss_tm_stats_init(
+    struct ss_tm *self) {
+
+    // One extra so that a machine without transitions still gets an 
+    // allocation.
+    self->transition_hits = (uint64_t *)calloc(self->transitions_end + 1, sizeof(uint64_t));
+    if(!self->transition_hits)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    return ss_tm_stats_reset(self);
+}
+#endif
+
+// Returns NULL if there's no transition for (state, in_char).
+    static inline struct ss_tm_transition *
+ss_tm_find_transition(
+    const struct ss_tm *self,
+    uint64_t state,
+    uint64_t in_char) {
+
+    size_t slot = ss_tm_index_slot(state, in_char, self->index_mask);
+    size_t entry;
+    while((entry = self->index[slot]) != 0) {
+        struct ss_tm_transition *t = &self->transitions[entry - 1];
+        if(t->in_state == state && t->in_char == in_char)
+            return t;
+        slot = (slot + 1) & self->index_mask;
+    }
+    return NULL;
+}
+
+// Adds transitions[i] to the index, which must have room for it.
+    static void
+ss_tm_index_insert(
+    struct ss_tm *self,
+    size_t i) {
+
+    size_t slot = ss_tm_index_slot(
+        self->transitions[i].in_state,
+        self->transitions[i].in_char,
+        self->index_mask);
+    while(self->index[slot] != 0)
+        slot = (slot + 1) & self->index_mask;
+    self->index[slot] = i + 1;
+}
+
+    static int
+ss_tm_transition_compare(
+    const void *a,
+    const void *b) {
+
+    const struct ss_tm_transition *ta = (const struct ss_tm_transition *)a;
+    const struct ss_tm_transition *tb = (const struct ss_tm_transition *)b;
+    if(ta->in_state != tb->in_state)
+        return ta->in_state < tb->in_state ? -1 : 1;
+    if(ta->in_char != tb->in_char)
+        return ta->in_char < tb->in_char ? -1 : 1;
+    if(ta->out_state != tb->out_state)
+        return ta->out_state < tb->out_state ? -1 : 1;
+    if(ta->out_char != tb->out_char)
+        return ta->out_char < tb->out_char ? -1 : 1;
+    return (int)ta->out_right - (int)tb->out_right;
+}
+
+// Sorts a nondeterministic machine's transitions so those sharing a key are
+// contiguous, merges exact duplicates, and indexes the first of each key.
+    static enum ss_tm_err
+ss_tm_index_build_nondeterministic(
+    struct ss_tm *self) {
+
+    qsort(self->transitions, self->transitions_end, sizeof(struct ss_tm_transition),
+        ss_tm_transition_compare);
+    size_t num_unique = 0;
+    size_t num_keys = 0;
+    size_t i;
+    for(i = 0; i < self->transitions_end; i++) {
+        struct ss_tm_transition *t = &self->transitions[i];
+        if(num_unique > 0 && ss_tm_transition_compare(&self->transitions[num_unique - 1], t) == 0)
+            continue;
+        if(num_unique == 0 ||
+            self->transitions[num_unique - 1].in_state != t->in_state ||
+            self->transitions[num_unique - 1].in_char != t->in_char) {
+
+            num_keys++;
+        }
+        self->transitions[num_unique++] = *t;
+    }
+    self->transitions_end = num_unique;
+
+    size_t index_size = 16;
+    while(index_size < num_keys * 2)
+        index_size *= 2;
+    size_t *index = (size_t *)calloc(index_size, sizeof(size_t));
+    if(!index)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    free(self->index);
+    self->index = index;
+    self->index_mask = index_size - 1;
+    for(i = 0; i < self->transitions_end; i++) {
+        if(i == 0 ||
+            self->transitions[i - 1].in_state != self->transitions[i].in_state ||
+            self->transitions[i - 1].in_char != self->transitions[i].in_char) {
+
+            ss_tm_index_insert(self, i);
+        }
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
 
     enum ss_tm_err
 ss_tm_init_begin(
@@ -14,9 +181,24 @@ ss_tm_init_begin(
         return SS_TM_ERR_ALLOCATION_FAILED;
     self->transitions_end = 0;
     self->transitions_size = 16;
+    self->index = (size_t *)calloc(32, sizeof(size_t));
+    if(!self->index) {
+        free(self->transitions);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->index_mask = 31;
+    self->owns_transitions = true;
+    self->nondeterministic = false;
 
     self->simulation_started = false;
     self->tape = NULL;
+    self->tape_capacity = 0;
+    self->tape_used = 0;
+    self->tape_generation = 0;
+    self->tape_mapping_size = 0;
+    self->tape_mapped_cells = 0;
+    self->max_tape_cells = 0;
+    self->budget = NULL;
 
     return SS_TM_ERR_NO_ERROR;
 }
@@ -26,13 +208,10 @@ ss_tm_add_state_transition(
     struct ss_tm *self,
     struct ss_tm_transition to_add) {
 
-    int i;
-    for(i = 0; i < self->transitions_end; i++) {
-        if(self->transitions[i].in_state == to_add.in_state &&
-            self->transitions[i].in_char == to_add.in_char) {
-            
-            return SS_TM_ERR_ADDING_ALREADY_EXISTING_STATE;
-        }
+    if(!self->nondeterministic &&
+        ss_tm_find_transition(self, to_add.in_state, to_add.in_char)) {
+
+        return SS_TM_ERR_ADDING_ALREADY_EXISTING_STATE;
     }
 
     if(self->init) {
@@ -47,7 +226,32 @@ ss_tm_add_state_transition(
             return SS_TM_ERR_ALLOCATION_FAILED;
         self->transitions_size = self->transitions_size * 2;
     }
-    self->transitions[self->transitions_end++] = to_add;
+
+    // Nondeterministic machines get their index once the transitions are 
+    // sorted, in ss_tm_init_end.
+    if(self->nondeterministic) {
+        self->transitions[self->transitions_end++] = to_add;
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    // Keep the load factor at or below 1/2 so probe sequences stay short and 
+    // there is always an empty slot to terminate a failed lookup.
+    if((self->transitions_end + 1) * 2 > self->index_mask + 1) {
+        size_t index_size = (self->index_mask + 1) * 2;
+        size_t *index = (size_t *)calloc(index_size, sizeof(size_t));
+        if(!index)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        free(self->index);
+        self->index = index;
+        self->index_mask = index_size - 1;
+        size_t i;
+        for(i = 0; i < self->transitions_end; i++)
+            ss_tm_index_insert(self, i);
+    }
+
+    self->transitions[self->transitions_end] = to_add;
+    ss_tm_index_insert(self, self->transitions_end);
+    self->transitions_end++;
     
     return SS_TM_ERR_NO_ERROR;
 }
@@ -59,39 +263,710 @@ ss_tm_init_end(
     if(self->init) {
         return SS_TM_ERR_MACHINE_ALREADY_INITIALIZED;
     }
+
+    if(self->nondeterministic) {
+        enum ss_tm_err e = ss_tm_index_build_nondeterministic(self);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+
+#ifdef SS_TM_STATS
+    if(ss_tm_stats_init(self) != SS_TM_ERR_NO_ERROR)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+#endif
+
     self->init = true;
     return SS_TM_ERR_NO_ERROR;
 }
 
+    enum ss_tm_err
+ss_tm_init_begin_nondeterministic(
+    struct ss_tm *self) {
+
+    enum ss_tm_err e = ss_tm_init_begin(self);
+    if(e == SS_TM_ERR_NO_ERROR)
+        self->nondeterministic = true;
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_find_transitions(
+    const struct ss_tm *self,
+    uint64_t state,
+    uint64_t in_char,
+    const struct ss_tm_transition **out_transitions,
+    size_t *out_num_transitions) {
+
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+
+    const struct ss_tm_transition *first = ss_tm_find_transition(self, state, in_char);
+    const struct ss_tm_transition *last = first;
+    if(first) {
+        const struct ss_tm_transition *end = self->transitions + self->transitions_end;
+        while(last != end && last->in_state == state && last->in_char == in_char)
+            last++;
+    }
+    *out_transitions = first;
+    *out_num_transitions = last - first;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_init_borrow(
+    struct ss_tm *self,
+    const struct ss_tm *machine) {
+
+    if(!machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+
+    self->init = true;
+    self->transitions = machine->transitions;
+    self->transitions_end = machine->transitions_end;
+    self->transitions_size = machine->transitions_size;
+    self->index = machine->index;
+    self->index_mask = machine->index_mask;
+    self->owns_transitions = false;
+    self->nondeterministic = machine->nondeterministic;
+
+    self->simulation_started = false;
+    self->tape = NULL;
+    self->tape_capacity = 0;
+    self->tape_used = 0;
+    self->tape_generation = 0;
+    self->tape_mapping_size = 0;
+    self->tape_mapped_cells = 0;
+    self->max_tape_cells = machine->max_tape_cells;
+    self->budget = machine->budget;
+
+#ifdef SS_TM_STATS
+    return ss_tm_stats_init(self);
+#else
+    return SS_TM_ERR_NO_ERROR;
+#endif
+}
+
+// Builds the index for self->transitions in index, which has room for 
+// index_capacity slots.
+    static enum ss_tm_err
+ss_tm_index_build_static(
+    struct ss_tm *self,
+    size_t *index,
+    size_t index_capacity) {
+
+    size_t index_size = 16;
+    while(index_size < self->transitions_end * 2)
+        index_size *= 2;
+    if(index_size > index_capacity)
+        return SS_TM_ERR_OUT_OF_RANGE;
+    memset(index, 0, index_size * sizeof(size_t));
+    self->index = index;
+    self->index_mask = index_size - 1;
+
+    size_t i;
+    for(i = 0; i < self->transitions_end; i++) {
+        if(ss_tm_find_transition(self, self->transitions[i].in_state, self->transitions[i].in_char))
+            return SS_TM_ERR_ADDING_ALREADY_EXISTING_STATE;
+        ss_tm_index_insert(self, i);
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_init_static(
+    struct ss_tm *self,
+    struct ss_tm_transition *transitions,
+    size_t transitions_end,
+    size_t *index,
+    size_t index_capacity) {
+
+    self->init = false;
+    self->transitions = transitions;
+    self->transitions_end = transitions_end;
+    self->transitions_size = transitions_end;
+    self->owns_transitions = false;
+    self->nondeterministic = false;
+    self->simulation_started = false;
+    self->tape = NULL;
+    self->tape_capacity = 0;
+    self->tape_used = 0;
+    self->tape_generation = 0;
+    self->tape_mapping_size = 0;
+    self->tape_mapped_cells = 0;
+    self->max_tape_cells = 0;
+    self->budget = NULL;
+
+    enum ss_tm_err e = ss_tm_index_build_static(self, index, index_capacity);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+#ifdef SS_TM_STATS
+    e = ss_tm_stats_init(self);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+#endif
+    self->init = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_reinit_static(
+    struct ss_tm *self,
+    struct ss_tm_transition *transitions,
+    size_t transitions_end,
+    size_t *index,
+    size_t index_capacity) {
+
+#ifdef SS_TM_STATS
+    if(self->init)
+        free(self->transition_hits);
+#endif
+    self->init = false;
+    self->transitions = transitions;
+    self->transitions_end = transitions_end;
+    self->transitions_size = transitions_end;
+    self->simulation_started = false;
+
+    enum ss_tm_err e = ss_tm_index_build_static(self, index, index_capacity);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+#ifdef SS_TM_STATS
+    e = ss_tm_stats_init(self);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+#endif
+    self->init = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_validate_input(
+    const uint64_t *input_string,
+    size_t input_string_size) {
+
+    // Valid characters are 1..(max(uint64_t) / 2). Subtracting one maps 0 to 
+    // max(uint64_t), so a single unsigned comparison rejects both ends. The 
+    // loop has no early exit so that the compiler can vectorize it.
+    uint64_t invalid = 0;
+    size_t i;
+    for(i = 0; i < input_string_size; i++)
+        invalid |= (input_string[i] - 1) > 0x7FFFFFFFFFFFFFFEull;
+    return invalid ? SS_TM_ERR_UNACCEPTABLE_INPUT_CHAR : SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_budget_init(
+    struct ss_tm_budget *self,
+    size_t limit,
+    struct ss_tm_budget *parent) {
+
+    self->limit = limit;
+    self->used = 0;
+    self->parent = parent;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_budget_charge(
+    struct ss_tm_budget *self,
+    size_t bytes) {
+
+    struct ss_tm_budget *b;
+    for(b = self; b; b = b->parent) {
+        // Take first and give back on overshoot, as a compare-and-swap loop 
+        // would only make contended charges slower.
+        size_t used = __atomic_add_fetch(&b->used, bytes, __ATOMIC_RELAXED);
+        if(b->limit && used > b->limit) {
+            struct ss_tm_budget *charged;
+            for(charged = self; charged != b->parent; charged = charged->parent)
+                __atomic_sub_fetch(&charged->used, bytes, __ATOMIC_RELAXED);
+            return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+        }
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_budget_release(
+    struct ss_tm_budget *self,
+    size_t bytes) {
+
+    struct ss_tm_budget *b;
+    for(b = self; b; b = b->parent)
+        __atomic_sub_fetch(&b->used, bytes, __ATOMIC_RELAXED);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Bytes of the tape charged to the budget.
+    static size_t
+ss_tm_tape_charged_bytes(
+    const struct ss_tm *self) {
+
+    return (self->tape_capacity - self->tape_mapped_cells) * sizeof(uint64_t);
+}
+
+    static void
+ss_tm_tape_free(
+    struct ss_tm *self) {
+
+    if(self->tape_mapping_size)
+        munmap(self->tape, self->tape_mapping_size);
+    else
+        free(self->tape);
+}
+
+    enum ss_tm_err
+ss_tm_set_space_limits(
+    struct ss_tm *self,
+    size_t max_tape_cells,
+    struct ss_tm_budget *budget) {
+
+    if(budget != self->budget) {
+        size_t bytes = ss_tm_tape_charged_bytes(self);
+        enum ss_tm_err e = ss_tm_budget_charge(budget, bytes);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+        ss_tm_budget_release(self->budget, bytes);
+    }
+    self->max_tape_cells = max_tape_cells;
+    self->budget = budget;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_release_tape(
+    struct ss_tm *self) {
+
+    ss_tm_budget_release(self->budget, ss_tm_tape_charged_bytes(self));
+    ss_tm_tape_free(self);
+    self->tape = NULL;
+    self->tape_size = 0;
+    self->tape_capacity = 0;
+    self->tape_used = 0;
+    self->tape_mapping_size = 0;
+    self->tape_mapped_cells = 0;
+    self->tape_generation++;
+    self->simulation_started = false;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Readies the tape for a new simulation of input_string_size cells of input, 
+// reusing the last simulation's tape if it's big enough. Cells from 
+// input_string_size on are blank; the caller fills in the input.
+    static enum ss_tm_err
+ss_tm_tape_reset(
+    struct ss_tm *self,
+    size_t tape_size,
+    size_t input_string_size) {
+
+    if(self->tape && !self->tape_mapping_size && tape_size <= self->tape_capacity) {
+        // Only the cells the last simulation used can be non-blank.
+        if(self->tape_used > input_string_size) {
+            memset(self->tape + input_string_size, 0x00,
+                (self->tape_used - input_string_size) * sizeof(uint64_t));
+        }
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    ss_tm_release_tape(self);
+    enum ss_tm_err e = ss_tm_budget_charge(self->budget, tape_size * sizeof(uint64_t));
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    // calloc needed, since tape empty char is assumed to be 0.
+    self->tape = calloc(tape_size, sizeof(uint64_t));
+    if(!self->tape) {
+        ss_tm_budget_release(self->budget, tape_size * sizeof(uint64_t));
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->tape_capacity = tape_size;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Starts a simulation on a tape whose first tape_size cells hold the input, 
+// with the head at tape_head.
+    static void
+ss_tm_simulation_reset(
+    struct ss_tm *self,
+    size_t tape_size,
+    size_t tape_head) {
+
+    self->tape_size = tape_size;
+    self->tape_used = tape_size;
+    self->tape_generation++;
+    self->tape_head = tape_head;
+    self->tape_reallocs = 0;
+    SS_TM_STAT(if(self->stats.head_min > tape_head)
+        self->stats.head_min = tape_head);
+    SS_TM_STAT(if(self->stats.head_max < tape_head)
+        self->stats.head_max = tape_head);
+    self->state = SS_TM_INITIAL_STATE;
+    self->steps = 0;
+    self->last_transition = self->transitions_end;
+    self->simulation_started = true;
+}
+
     enum ss_tm_err
 ss_tm_simulation_begin(
     struct ss_tm *self,
     uint64_t *input_string,
     size_t input_string_size) {
 
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    if(self->nondeterministic)
+        return SS_TM_ERR_NONDETERMINISTIC_MACHINE;
+
     // Check if the input string contains only valid characters: 
     // (1..(max(uint64_t) / 2))
-    int i;
-    for(i = 0; i < input_string_size; i++) {
-        if(input_string[i] < 1 || input_string[i] > 0x7FFFFFFFFFFFFFFF)
-            return SS_TM_ERR_UNACCEPTABLE_INPUT_CHAR;
+    enum ss_tm_err e = ss_tm_validate_input(input_string, input_string_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    // The head always needs a cell to read, even for the empty string.
+    size_t tape_size = input_string_size ? input_string_size : 1;
+    if(self->max_tape_cells && tape_size > self->max_tape_cells)
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+    e = ss_tm_tape_reset(self, tape_size, input_string_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    if(input_string_size)
+        memcpy(self->tape, input_string, input_string_size * sizeof(uint64_t));
+    ss_tm_simulation_reset(self, tape_size, 0);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_simulation_resume(
+    struct ss_tm *self,
+    const uint64_t *tape,
+    size_t tape_size,
+    size_t tape_head,
+    uint64_t state,
+    uint64_t steps) {
+
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    if(self->nondeterministic)
+        return SS_TM_ERR_NONDETERMINISTIC_MACHINE;
+
+    size_t num_cells = tape_size ? tape_size : 1;
+    if(tape_head >= num_cells)
+        return SS_TM_ERR_OUT_OF_RANGE;
+    if(self->max_tape_cells && num_cells > self->max_tape_cells)
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+    enum ss_tm_err e = ss_tm_tape_reset(self, num_cells, tape_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    if(tape_size)
+        memcpy(self->tape, tape, tape_size * sizeof(uint64_t));
+    ss_tm_simulation_reset(self, num_cells, tape_head);
+    self->state = state;
+    self->steps = steps;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Begin mapped input definitions
+
+// Address space reserved past a mapped input for the tape to grow into, if 
+// max_tape_cells doesn't say how far it can. Reserving it costs no memory.
+#define SS_TM_MAPPED_TAPE_RESERVE (1ull << 30)
+
+    static size_t
+ss_tm_page_round(
+    size_t bytes) {
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+// ss_tm_validate_input for cells narrower than 64 bits, all of whose values 
+// but 0 are valid.
+    static enum ss_tm_err
+ss_tm_validate_narrow_input(
+    const void *cells,
+    size_t num_cells,
+    size_t cell_width) {
+
+    // No early exits, as in ss_tm_validate_input.
+    uint64_t invalid = 0;
+    size_t i;
+    if(cell_width == 1) {
+        const uint8_t *c = (const uint8_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            invalid |= c[i] == 0;
+    } else if(cell_width == 2) {
+        const uint16_t *c = (const uint16_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            invalid |= c[i] == 0;
+    } else {
+        const uint32_t *c = (const uint32_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            invalid |= c[i] == 0;
     }
+    return invalid ? SS_TM_ERR_UNACCEPTABLE_INPUT_CHAR : SS_TM_ERR_NO_ERROR;
+}
 
-    free(self->tape);
-    // calloc needed, since tape empty char is assumed to be 0.
-    self->tape = calloc(input_string_size, sizeof(uint64_t));
-    if(!self->tape)
+    static void
+ss_tm_widen_input(
+    uint64_t *tape,
+    const void *cells,
+    size_t num_cells,
+    size_t cell_width) {
+
+    size_t i;
+    if(cell_width == 1) {
+        const uint8_t *c = (const uint8_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            tape[i] = c[i];
+    } else if(cell_width == 2) {
+        const uint16_t *c = (const uint16_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            tape[i] = c[i];
+    } else {
+        const uint32_t *c = (const uint32_t *)cells;
+        for(i = 0; i < num_cells; i++)
+            tape[i] = c[i];
+    }
+}
+
+// Makes the tape a private mapping of fd's file_bytes bytes of 8-byte cells.
+    static enum ss_tm_err
+ss_tm_tape_map(
+    struct ss_tm *self,
+    int fd,
+    size_t file_bytes,
+    bool trusted) {
+
+    size_t file_span = ss_tm_page_round(file_bytes);
+    // An empty input still needs a cell under the head.
+    size_t accessible = file_span ? file_span : ss_tm_page_round(1);
+    size_t reserve = self->max_tape_cells ?
+        ss_tm_page_round(self->max_tape_cells * sizeof(uint64_t)) :
+        accessible + SS_TM_MAPPED_TAPE_RESERVE;
+    if(reserve < accessible)
+        reserve = accessible;
+
+    // Reserve the address space the tape may grow into, then put the file at 
+    // its start. Bytes past the end of the file in its last page read as 0, 
+    // which is blank.
+    char *base = (char *)mmap(NULL, reserve, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(base == MAP_FAILED)
         return SS_TM_ERR_ALLOCATION_FAILED;
-    memcpy(self->tape, input_string, input_string_size * sizeof(uint64_t));
-    self->tape_size = input_string_size;
-    self->tape_head = 0;
-    self->state = SS_TM_INITIAL_STATE;
-    self->simulation_started = true;
+    if(file_span && mmap(base, file_span, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+
+        munmap(base, reserve);
+        return SS_TM_ERR_IO_FAILED;
+    }
+    if(!trusted) {
+        enum ss_tm_err e = ss_tm_validate_input(
+            (const uint64_t *)base, file_bytes / sizeof(uint64_t));
+        if(e != SS_TM_ERR_NO_ERROR) {
+            munmap(base, reserve);
+            return e;
+        }
+    }
+
+    ss_tm_release_tape(self);
+    if(!file_span) {
+        enum ss_tm_err e = ss_tm_budget_charge(self->budget, accessible);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            munmap(base, reserve);
+            return e;
+        }
+        if(mprotect(base, accessible, PROT_READ | PROT_WRITE) != 0) {
+            ss_tm_budget_release(self->budget, accessible);
+            munmap(base, reserve);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+    }
+    self->tape = (uint64_t *)base;
+    self->tape_capacity = accessible / sizeof(uint64_t);
+    self->tape_mapping_size = reserve;
+    self->tape_mapped_cells = file_span / sizeof(uint64_t);
     return SS_TM_ERR_NO_ERROR;
 }
 
+// Reads fd's file_bytes bytes of cells narrower than the tape's into an 
+// ordinary tape.
+    static enum ss_tm_err
+ss_tm_tape_widen(
+    struct ss_tm *self,
+    int fd,
+    size_t file_bytes,
+    size_t cell_width,
+    bool trusted) {
+
+    size_t num_cells = file_bytes / cell_width;
+    void *cells = NULL;
+    if(file_bytes) {
+        cells = mmap(NULL, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(cells == MAP_FAILED)
+            return SS_TM_ERR_IO_FAILED;
+    }
+    enum ss_tm_err e = trusted ? SS_TM_ERR_NO_ERROR :
+        ss_tm_validate_narrow_input(cells, num_cells, cell_width);
+    if(e == SS_TM_ERR_NO_ERROR)
+        e = ss_tm_tape_reset(self, num_cells ? num_cells : 1, num_cells);
+    if(e == SS_TM_ERR_NO_ERROR)
+        ss_tm_widen_input(self->tape, cells, num_cells, cell_width);
+    if(file_bytes)
+        munmap(cells, file_bytes);
+    return e;
+}
+
     enum ss_tm_err
-ss_tm_simulation_step(
+ss_tm_simulation_begin_mapped(
+    struct ss_tm *self,
+    const char *path,
+    size_t cell_width,
+    bool trusted) {
+
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    if(self->nondeterministic)
+        return SS_TM_ERR_NONDETERMINISTIC_MACHINE;
+    if(cell_width != 1 && cell_width != 2 && cell_width != 4 && cell_width != 8)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return SS_TM_ERR_IO_FAILED;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return SS_TM_ERR_IO_FAILED;
+    }
+    size_t file_bytes = st.st_size;
+    if(file_bytes % cell_width != 0) {
+        close(fd);
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    }
+    size_t input_string_size = file_bytes / cell_width;
+    size_t tape_size = input_string_size ? input_string_size : 1;
+    if(self->max_tape_cells && tape_size > self->max_tape_cells) {
+        close(fd);
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+    }
+
+    enum ss_tm_err e = cell_width == sizeof(uint64_t) ?
+        ss_tm_tape_map(self, fd, file_bytes, trusted) :
+        ss_tm_tape_widen(self, fd, file_bytes, cell_width, trusted);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    ss_tm_simulation_reset(self, tape_size, 0);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// ss_tm_tape_grow for a mapped tape that's outgrown its accessible pages. It 
+// grows in place while the reservation lasts, and then moves to the heap like 
+// any other tape.
+    static enum ss_tm_err
+ss_tm_tape_grow_mapped(
+    struct ss_tm *self,
+    size_t new_size) {
+
+    size_t old_bytes = self->tape_capacity * sizeof(uint64_t);
+    size_t new_bytes = ss_tm_page_round(new_size * sizeof(uint64_t));
+    if(new_bytes <= self->tape_mapping_size) {
+        enum ss_tm_err e = ss_tm_budget_charge(self->budget, new_bytes - old_bytes);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            SS_TM_STAT(self->stats.halts_space_limit++);
+            return e;
+        }
+        if(mprotect((char *)self->tape + old_bytes, new_bytes - old_bytes,
+            PROT_READ | PROT_WRITE) != 0) {
+
+            ss_tm_budget_release(self->budget, new_bytes - old_bytes);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        SS_TM_STAT(self->stats.tape_grows++);
+        self->tape_size = new_size;
+        self->tape_capacity = new_bytes / sizeof(uint64_t);
+        self->tape_reallocs++;
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    // The file's cells are copied over, so they're charged from now on.
+    size_t charge_bytes = new_size * sizeof(uint64_t) - ss_tm_tape_charged_bytes(self);
+    enum ss_tm_err e = ss_tm_budget_charge(self->budget, charge_bytes);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        SS_TM_STAT(self->stats.halts_space_limit++);
+        return e;
+    }
+    uint64_t *tape = (uint64_t *)malloc(new_size * sizeof(uint64_t));
+    if(!tape) {
+        ss_tm_budget_release(self->budget, charge_bytes);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    SS_TM_STAT(self->stats.tape_grows++);
+    SS_TM_STAT(self->stats.tape_bytes_copied += old_bytes);
+    memcpy(tape, self->tape, old_bytes);
+    memset(tape + self->tape_capacity, 0x00,
+        (new_size - self->tape_capacity) * sizeof(uint64_t));
+    munmap(self->tape, self->tape_mapping_size);
+    self->tape = tape;
+    self->tape_size = new_size;
+    self->tape_capacity = new_size;
+    self->tape_mapping_size = 0;
+    self->tape_mapped_cells = 0;
+    self->tape_reallocs++;
+    self->tape_generation++;
+    return SS_TM_ERR_NO_ERROR;
+}
+// End mapped input definitions
+
+// Makes room for the head to move right off the last cell of the tape. If it 
+// can't, the tape is left as it was.
+    static enum ss_tm_err
+ss_tm_tape_grow(
+    struct ss_tm *self) {
+
+    size_t new_size = 2 * self->tape_size;
+    if(self->max_tape_cells && new_size > self->max_tape_cells)
+        new_size = self->max_tape_cells;
+    if(new_size <= self->tape_size) {
+        SS_TM_STAT(self->stats.halts_space_limit++);
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+    }
+
+    if(new_size <= self->tape_capacity) {
+        // Already allocated, and blank, by an earlier simulation.
+        self->tape_size = new_size;
+        SS_TM_STAT(self->stats.tape_reuses++);
+        return SS_TM_ERR_NO_ERROR;
+    }
+    if(self->tape_mapping_size)
+        return ss_tm_tape_grow_mapped(self, new_size);
+
+    size_t new_bytes = (new_size - self->tape_capacity) * sizeof(uint64_t);
+    enum ss_tm_err e = ss_tm_budget_charge(self->budget, new_bytes);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        SS_TM_STAT(self->stats.halts_space_limit++);
+        return e;
+    }
+    uint64_t *tape = (uint64_t *)realloc(self->tape, new_size * sizeof(uint64_t));
+    if(!tape) {
+        ss_tm_budget_release(self->budget, new_bytes);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    SS_TM_STAT(self->stats.tape_grows++);
+    SS_TM_STAT(self->stats.tape_bytes_copied += self->tape_capacity * sizeof(uint64_t));
+    memset(tape + self->tape_capacity, 0x00, new_bytes);
+    self->tape = tape;
+    self->tape_size = new_size;
+    self->tape_capacity = new_size;
+    self->tape_reallocs++;
+    self->tape_generation++;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static inline enum ss_tm_err
+ss_tm_simulation_step_unsampled(
     struct ss_tm *self) {
 
     if(!self->simulation_started)
@@ -103,37 +978,69 @@ ss_tm_simulation_step(
         return SS_TM_ERR_STEP_ON_HALTED_MACHINE;
     }
 
-    int i;
-    for(i = 0; i < self->transitions_end; i++) {
-        if(self->transitions[i].in_state == self->state &&
-            self->transitions[i].in_char == self->tape[self->tape_head]) {
-            
-            self->state = self->transitions[i].out_state;
-            self->tape[self->tape_head] = self->transitions[i].out_char;
-            if(self->transitions[i].out_right) {
-                self->tape_head++;
-                if(self->tape_head == self->tape_size) {
-                    self->tape = realloc(self->tape, 2 * self->tape_size * sizeof(uint64_t));
-                    memset(self->tape + self->tape_head, 0x00, self->tape_size * sizeof(uint64_t));
-                    self->tape_size *= 2;
-                    if(!self->tape)
-                        return SS_TM_ERR_ALLOCATION_FAILED;
-                }
-            } else {
-                if(self->tape_head == 0) {
-                    fprintf(stderr, "Caller's TM is malformed. Attempted to move the "
-                        "head to the left when already on the left-most cell.\n");
-                    exit(-1);
-                }
-                self->tape_head--;
-            }
-            return SS_TM_ERR_NO_ERROR;
-        }
+    struct ss_tm_transition *t = ss_tm_find_transition(
+        self,
+        self->state,
+        self->tape[self->tape_head]);
+    if(!t) {
+        self->state = SS_TM_REJECT_STATE;
+        self->steps++;
+        self->last_transition = self->transitions_end;
+        SS_TM_STAT(self->stats.steps++);
+        SS_TM_STAT(self->stats.halts_no_transition++);
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    if(!t->out_right && self->tape_head == 0) {
+        SS_TM_STAT(self->stats.halts_fell_off_tape++);
+        return SS_TM_ERR_HEAD_FELL_OFF_TAPE;
+    }
+
+    // Make room before changing anything, so that a step the tape can't grow 
+    // for leaves the machine as it was.
+    if(t->out_right && self->tape_head + 1 == self->tape_size) {
+        enum ss_tm_err e = ss_tm_tape_grow(self);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+
+    self->state = t->out_state;
+    self->tape[self->tape_head] = t->out_char;
+    self->steps++;
+    self->last_transition = t - self->transitions;
+    SS_TM_STAT(self->stats.steps++);
+    SS_TM_STAT(self->transition_hits[self->last_transition]++);
+    SS_TM_STAT(self->stats.halts_accept += self->state == SS_TM_ACCEPT_STATE);
+    SS_TM_STAT(self->stats.halts_reject += self->state == SS_TM_REJECT_STATE);
+    if(t->out_right) {
+        self->tape_head++;
+        self->tape_used += self->tape_head == self->tape_used;
+        SS_TM_STAT(if(self->tape_head > self->stats.head_max)
+            self->stats.head_max = self->tape_head);
+    } else {
+        self->tape_head--;
+        SS_TM_STAT(if(self->tape_head < self->stats.head_min)
+            self->stats.head_min = self->tape_head);
     }
-    self->state = SS_TM_REJECT_STATE;
     return SS_TM_ERR_NO_ERROR;
 }
 
+    enum ss_tm_err
+ss_tm_simulation_step(
+    struct ss_tm *self) {
+
+#ifdef SS_TM_STATS
+    if((self->stats.steps & ((1ull << SS_TM_STATS_CYCLE_SAMPLE_SHIFT) - 1)) == 0) {
+        uint64_t begin = ss_tm_stats_cycles();
+        enum ss_tm_err e = ss_tm_simulation_step_unsampled(self);
+        self->stats.sampled_cycles += ss_tm_stats_cycles() - begin;
+        self->stats.sampled_steps++;
+        return e;
+    }
+#endif
+    return ss_tm_simulation_step_unsampled(self);
+}
+
     enum ss_tm_err
 ss_tm_simulation_step_multiple(
     struct ss_tm *self,
@@ -203,11 +1110,109 @@ ss_tm_peek_head_pos(
     return SS_TM_ERR_NO_ERROR;
 }
 
+    enum ss_tm_err
+ss_tm_peek_steps(
+    struct ss_tm *self,
+    uint64_t *steps) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    *steps = self->steps;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_stats_snapshot(
+    struct ss_tm *self,
+    struct ss_tm_stats *out_stats,
+    uint64_t *out_transition_hits) {
+
+#ifdef SS_TM_STATS
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    *out_stats = self->stats;
+    if(out_transition_hits) {
+        memcpy(out_transition_hits, self->transition_hits,
+            self->transitions_end * sizeof(uint64_t));
+    }
+    return SS_TM_ERR_NO_ERROR;
+#else
+    (void)self;
+    (void)out_stats;
+    (void)out_transition_hits;
+    return SS_TM_ERR_STATS_DISABLED;
+#endif
+}
+
+    enum ss_tm_err
+ss_tm_stats_reset(
+    struct ss_tm *self) {
+
+#ifdef SS_TM_STATS
+    memset(&self->stats, 0, sizeof(self->stats));
+    self->stats.head_min = SIZE_MAX;
+    memset(self->transition_hits, 0, self->transitions_end * sizeof(uint64_t));
+    return SS_TM_ERR_NO_ERROR;
+#else
+    (void)self;
+    return SS_TM_ERR_STATS_DISABLED;
+#endif
+}
+
+    enum ss_tm_err
+ss_tm_stats_dump(
+    struct ss_tm *self,
+    FILE *f) {
+
+#ifdef SS_TM_STATS
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    struct ss_tm_stats *s = &self->stats;
+    fprintf(f, "steps: %" PRIu64 "\n", s->steps);
+    fprintf(f, "tape grows: %" PRIu64 " (%" PRIu64 " bytes copied), %" PRIu64
+        " into kept capacity\n",
+        s->tape_grows, s->tape_bytes_copied, s->tape_reuses);
+    if(s->head_min <= s->head_max)
+        fprintf(f, "head range: %zu..%zu\n", s->head_min, s->head_max);
+    fprintf(f, "halts: %" PRIu64 " accept, %" PRIu64 " reject, %" PRIu64
+        " no transition, %" PRIu64 " fell off tape, %" PRIu64 " space limit\n",
+        s->halts_accept, s->halts_reject, s->halts_no_transition,
+        s->halts_fell_off_tape, s->halts_space_limit);
+    if(s->sampled_steps > 0) {
+        fprintf(f, "cycles per step: %.1f (%" PRIu64 " samples)\n",
+            (double)s->sampled_cycles / s->sampled_steps, s->sampled_steps);
+    }
+    size_t i;
+    for(i = 0; i < self->transitions_end; i++) {
+        if(self->transition_hits[i] == 0)
+            continue;
+        struct ss_tm_transition *t = &self->transitions[i];
+        fprintf(f, "transition %zu (%" PRIu64 ", %" PRIu64 ") -> (%" PRIu64
+            ", %" PRIu64 ", %s): %" PRIu64 " hits\n",
+            i, t->in_state, t->in_char, t->out_state, t->out_char,
+            t->out_right ? "right" : "left", self->transition_hits[i]);
+    }
+    return SS_TM_ERR_NO_ERROR;
+#else
+    (void)self;
+    return SS_TM_ERR_STATS_DISABLED;
+#endif
+}
+
     enum ss_tm_err
 ss_tm_destroy(
     struct ss_tm *self) {
 
-    free(self->transitions);
-    free(self->tape);
+#ifdef SS_TM_STATS
+    if(self->init)
+        free(self->transition_hits);
+#endif
+    if(self->owns_transitions) {
+        free(self->transitions);
+        free(self->index);
+    }
+    ss_tm_budget_release(self->budget, ss_tm_tape_charged_bytes(self));
+    ss_tm_tape_free(self);
     return SS_TM_ERR_NO_ERROR;
 }
\ No newline at end of file
@@ -4,13 +4,18 @@
 #include <stddef.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
 
-const uint64_t SS_TM_INITIAL_STATE = 0ull;
-const uint64_t SS_TM_ACCEPT_STATE = 0xFFFFFFFFFFFFFFFF;
-const uint64_t SS_TM_REJECT_STATE = 0xFFFFFFFFFFFFFFFE;
+// Define SS_TM_STATS (for every file including this header) to count what the
+// step path does; see ss_tm_stats_snapshot. Without it the counters and the
+// code updating them are compiled out.
 
-const bool SS_TM_DIR_LEFT = false;
-const bool SS_TM_DIR_RIGHT = true;
+static const uint64_t SS_TM_INITIAL_STATE = 0ull;
+static const uint64_t SS_TM_ACCEPT_STATE = 0xFFFFFFFFFFFFFFFF;
+static const uint64_t SS_TM_REJECT_STATE = 0xFFFFFFFFFFFFFFFE;
+
+static const bool SS_TM_DIR_LEFT = false;
+static const bool SS_TM_DIR_RIGHT = true;
 
 enum ss_tm_err {
     SS_TM_ERR_NO_ERROR,
@@ -19,23 +24,36 @@ enum ss_tm_err {
     SS_TM_ERR_MACHINE_ALREADY_INITIALIZED,
     SS_TM_ERR_UNACCEPTABLE_INPUT_CHAR,
     SS_TM_ERR_UNSTARTED_SIMULATION,
-    SS_TM_ERR_STEP_ON_HALTED_MACHINE
+    SS_TM_ERR_STEP_ON_HALTED_MACHINE,
+    SS_TM_ERR_HEAD_FELL_OFF_TAPE,
+    SS_TM_ERR_MACHINE_NOT_INITIALIZED,
+    SS_TM_ERR_THREAD_CREATE_FAILED,
+    SS_TM_ERR_MEMORY_LIMIT_REACHED,
+    SS_TM_ERR_IO_FAILED,
+    SS_TM_ERR_BAD_FILE_FORMAT,
+    SS_TM_ERR_OUT_OF_RANGE,
+    SS_TM_ERR_STATS_DISABLED,
+    SS_TM_ERR_STALE_VIEW,
+    SS_TM_ERR_NONDETERMINISTIC_MACHINE
 };
 
-char *ss_tm_err_str[] = {
-    "ss_tm: no error",
-    "ss_tm: memory allocation failed",
-    "ss_tm: The inputs of the given transition matched the inputs of an already"
-        "of a transition already in the transition map.",
-    "ss_tm: The machine has already been initialized. (You're probably trying "
-        "to perform an action that can only be done in initialization.)",
-    "ss_tm: The input string contained an invalid character. Recall that "
-        "input characters must be in the range 1..(max(uint64_t)/2)",
-    "ss_tm: The simulation hasn't been started. (You're probably trying to "
-        "perform an action that can only be done after a simulation has been "
-        "started.)",
-    "ss_tm: The machine has halted, but you attempted to perform a simulation "
-        "step."
+// Indexed by enum ss_tm_err. Defined in ss_tm.c.
+extern char *ss_tm_err_str[];
+
+// How a simulation run ended, as reported by the drivers that run many
+// simulations at once (see ss_tm_batch.h and ss_tm_sched.h).
+enum ss_tm_outcome {
+    SS_TM_OUTCOME_ACCEPT,
+    SS_TM_OUTCOME_REJECT,
+    // The step limit was reached before the machine halted.
+    SS_TM_OUTCOME_TIMEOUT,
+    // The simulation stopped on an error. The accompanying ss_tm_err says which.
+    SS_TM_OUTCOME_ERROR,
+    // A caller-supplied classifier decided the simulation's fate before it
+    // halted.
+    SS_TM_OUTCOME_CLASSIFIED,
+    // The simulation's tape outgrew the memory it was allowed.
+    SS_TM_OUTCOME_SPACE_LIMIT
 };
 
 struct ss_tm_transition {
@@ -47,6 +65,50 @@ struct ss_tm_transition {
     bool out_right;
 };
 
+// Counters accumulated over every simulation of a machine since it was
+// initialized or the counters were reset.
+struct ss_tm_stats {
+    uint64_t steps;
+    // Times the tape was grown, and the bytes of tape each growth had to carry
+    // over to the new allocation.
+    uint64_t tape_grows;
+    uint64_t tape_bytes_copied;
+    // Times the tape grew into cells an earlier simulation had already
+    // allocated, which needs no allocation or copy.
+    uint64_t tape_reuses;
+    // Extremes of the head position. head_min > head_max until a simulation
+    // has started.
+    size_t head_min;
+    size_t head_max;
+    // Why simulations stopped.
+    uint64_t halts_accept;
+    uint64_t halts_reject;
+    // Rejections because no transition matched.
+    uint64_t halts_no_transition;
+    // Steps refused because they'd move the head off the left end.
+    uint64_t halts_fell_off_tape;
+    // Steps refused because the tape couldn't grow within its limits.
+    uint64_t halts_space_limit;
+    // One step in every 2^SS_TM_STATS_CYCLE_SAMPLE_SHIFT is timed with the
+    // cycle counter, so average cycles per step is
+    // sampled_cycles / sampled_steps.
+    uint64_t sampled_steps;
+    uint64_t sampled_cycles;
+};
+
+#define SS_TM_STATS_CYCLE_SAMPLE_SHIFT 10
+
+// A pool of memory shared by the tapes of many simulations, possibly running
+// on different threads. Charges and releases are atomic, so it needs no lock.
+struct ss_tm_budget {
+    // In bytes. 0 for no limit.
+    size_t limit;
+    size_t used;
+    // If not NULL, everything charged to this budget is charged to parent as
+    // well, and fails if either is exhausted.
+    struct ss_tm_budget *parent;
+};
+
 struct ss_tm {
     // States are assumed to range over 0..max(uint64_t)
     // Initial, accept, and reject state constants (above) should be used for those.
@@ -58,14 +120,62 @@ struct ss_tm {
     struct ss_tm_transition *transitions;
     size_t transitions_end;
     size_t transitions_size;
+    // Open-addressed hash of (in_state, in_char) -> 1 + index into
+    // transitions. 0 marks an empty slot. Kept up to date by
+    // ss_tm_add_state_transition, which uses it to reject duplicates, and
+    // read-only once the machine is initialized.
+    size_t *index;
+    size_t index_mask;
+    // false if transitions and index belong to another machine (see
+    // ss_tm_init_borrow).
+    bool owns_transitions;
+    // true if the machine was begun with ss_tm_init_begin_nondeterministic.
+    // transitions is then sorted by (in_state, in_char), and the index leads
+    // to the first transition of each run sharing a key.
+    bool nondeterministic;
 
     // For simulations
     bool simulation_started;
     uint64_t *tape;
     size_t tape_size;
+    // Cells allocated for tape. The tape is kept between simulations, so 
+    // this can exceed tape_size; cells past tape_size are always blank.
+    size_t tape_capacity;
+    // Cells from tape_used on have never been written or under the head, so
+    // they're blank.
+    size_t tape_used;
+    // Changes whenever tape may move or a new simulation starts, so views of
+    // the tape (see ss_tm_view.h) can tell they're stale.
+    uint64_t tape_generation;
     size_t tape_head;
+    // Times the tape has been reallocated (or, when mapped, had more pages
+    // made accessible) since the simulation began. Growing into capacity kept
+    // from an earlier simulation doesn't count.
+    uint64_t tape_reallocs;
+    // Most cells the tape may have; 0 for no limit. See ss_tm_set_space_limits.
+    size_t max_tape_cells;
+    // Charged for tape_capacity cells, bar tape_mapped_cells, if not NULL.
+    struct ss_tm_budget *budget;
+    // If not 0, tape is a private mapping of an input file (see 
+    // ss_tm_simulation_begin_mapped) in a reservation of this many bytes of 
+    // address space, rather than from malloc. tape_capacity then counts the 
+    // cells made accessible so far, a whole number of pages.
+    size_t tape_mapping_size;
+    // Cells at the start of a mapped tape backed by the file. They're the 
+    // page cache's until written, so they aren't charged to the budget.
+    size_t tape_mapped_cells;
 
     uint64_t state;
+    uint64_t steps;
+    // Index into transitions of the transition the last step took, or 
+    // transitions_end if the last step rejected for want of one.
+    size_t last_transition;
+
+#ifdef SS_TM_STATS
+    struct ss_tm_stats stats;
+    // Times each transition has been taken, indexed like transitions.
+    uint64_t *transition_hits;
+#endif
 };
 
 // Any function def found between init_begin and init_end should only be called 
@@ -86,19 +196,173 @@ ss_tm_add_state_transition(
     enum ss_tm_err
 ss_tm_init_end(
     struct ss_tm *self);
+
+// Like ss_tm_init_begin, but for a nondeterministic machine: any number of
+// transitions may be added for the same (in_state, in_char), and exact 
+// duplicates are merged by ss_tm_init_end. Such a machine can't be simulated
+// with ss_tm_simulation_begin, which fails with 
+// SS_TM_ERR_NONDETERMINISTIC_MACHINE; explore it with ss_tm_ntm.h instead.
+    enum ss_tm_err
+ss_tm_init_begin_nondeterministic(
+    struct ss_tm *self);
 // End init definitions
 
+// Gets the transitions for (state, in_char), contiguous in self->transitions.
+// out_num_transitions receives 0 if there are none, and at most 1 unless the 
+// machine is nondeterministic.
+    enum ss_tm_err
+ss_tm_find_transitions(
+    const struct ss_tm *self,
+    uint64_t state,
+    uint64_t in_char,
+    const struct ss_tm_transition **out_transitions,
+    size_t *out_num_transitions);
+
+// Initializes self as an already-initialized machine which shares machine's
+// transition table rather than copying it. Only the simulation state (tape,
+// head, state) belongs to self, so several borrowers of one machine may be
+// simulated on different threads at once. machine must be initialized and
+// must outlive every machine borrowing from it. self starts out with 
+// machine's space limits.
+    enum ss_tm_err
+ss_tm_init_borrow(
+    struct ss_tm *self,
+    const struct ss_tm *machine);
+
+// Initializes self over caller-owned storage, with no heap allocation (bar 
+// the statistics, if compiled in). The transitions_end transitions are used 
+// in place, and their index is built in index, which needs room for the 
+// smallest power of two at least 16 and at least 2 * transitions_end slots; 
+// fails with SS_TM_ERR_OUT_OF_RANGE if index_capacity is less. Both arrays 
+// must outlive the machine and mustn't change while it's in use.
+    enum ss_tm_err
+ss_tm_init_static(
+    struct ss_tm *self,
+    struct ss_tm_transition *transitions,
+    size_t transitions_end,
+    size_t *index,
+    size_t index_capacity);
+
+// Like ss_tm_init_static, for a machine already set up by it: any simulation
+// ends and the table is replaced, but the tape allocation is kept for the 
+// next simulation to reuse. Decoding many machines into the same buffers and 
+// re-initializing one machine over them allocates nothing per machine.
+    enum ss_tm_err
+ss_tm_reinit_static(
+    struct ss_tm *self,
+    struct ss_tm_transition *transitions,
+    size_t transitions_end,
+    size_t *index,
+    size_t index_capacity);
+
     enum ss_tm_err
 ss_tm_destroy(
     struct ss_tm *self);
 
+// Checks that every character of input_string is a valid input character.
+// This is the check performed by ss_tm_simulation_begin.
+    enum ss_tm_err
+ss_tm_validate_input(
+    const uint64_t *input_string,
+    size_t input_string_size);
+
+// Begin space limit definitions
+
+    enum ss_tm_err
+ss_tm_budget_init(
+    struct ss_tm_budget *self,
+    size_t limit,
+    struct ss_tm_budget *parent);
+
+// Takes bytes from self and its ancestors, or fails with 
+// SS_TM_ERR_MEMORY_LIMIT_REACHED, taking nothing, if any of them would go 
+// over its limit. A NULL self always succeeds.
+    enum ss_tm_err
+ss_tm_budget_charge(
+    struct ss_tm_budget *self,
+    size_t bytes);
+
+// Gives back bytes taken by ss_tm_budget_charge.
+    enum ss_tm_err
+ss_tm_budget_release(
+    struct ss_tm_budget *self,
+    size_t bytes);
+
+// Caps the tape at max_tape_cells cells (0 for no cap) and charges it to 
+// budget (NULL for none) from now on. The tape already allocated moves over 
+// to budget, and if it doesn't fit, fails with SS_TM_ERR_MEMORY_LIMIT_REACHED 
+// and leaves the limits as they were. A tape already longer than 
+// max_tape_cells isn't cut short, but won't grow. budget must outlive the 
+// machine, or its next ss_tm_set_space_limits.
+    enum ss_tm_err
+ss_tm_set_space_limits(
+    struct ss_tm *self,
+    size_t max_tape_cells,
+    struct ss_tm_budget *budget);
+
+// Ends any simulation and frees the tape, giving its memory back to the 
+// budget. A machine keeps its tape between simulations otherwise, so this is 
+// how one that ran out of space makes room for others.
+    enum ss_tm_err
+ss_tm_release_tape(
+    struct ss_tm *self);
+// End space limit definitions
+
 // Begin simulation definitions
+// Fails with SS_TM_ERR_MEMORY_LIMIT_REACHED if the input doesn't fit in the 
+// machine's space limits.
     enum ss_tm_err
 ss_tm_simulation_begin(
     struct ss_tm *self,
     uint64_t *input_string,
     size_t input_string_size);
 
+// Like ss_tm_simulation_begin, with the input read from the file at path, 
+// cell_width (1, 2, 4 or 8) bytes per character in native byte order. 
+// 8-byte cells aren't copied: the tape is a private mapping of the file, 
+// whose pages are only read from disk when the head reaches them and only 
+// copied when the machine writes to them, and it grows in place into 
+// address space reserved past the file. Narrower cells are widened into an 
+// ordinary tape. Unless trusted, the characters are still checked first, 
+// which reads the whole file; a trusted 8-byte input starts in time 
+// independent of its size. Fails with SS_TM_ERR_IO_FAILED if the file can't 
+// be read or mapped, SS_TM_ERR_BAD_FILE_FORMAT if its size isn't a multiple 
+// of cell_width, and SS_TM_ERR_OUT_OF_RANGE if cell_width isn't one of 
+// those.
+//
+// An 8-byte input stays mapped until the tape is released, the next
+// simulation begins, or the tape outgrows its reservation. Until then the
+// file must not be truncated or shrunk: the machine reading a page that no
+// longer has file behind it raises SIGBUS, which kills the process. Writes
+// to the file meanwhile may or may not show up on the tape.
+    enum ss_tm_err
+ss_tm_simulation_begin_mapped(
+    struct ss_tm *self,
+    const char *path,
+    size_t cell_width,
+    bool trusted);
+
+// Starts a simulation partway through, as if steps steps had left the first 
+// tape_size cells of the tape holding tape, with the head at tape_head and 
+// the machine in state. For restoring snapshots (see ss_tm_image.h), so the 
+// cells may hold any tape characters and aren't checked. Fails with 
+// SS_TM_ERR_OUT_OF_RANGE if tape_head is past the tape, and 
+// SS_TM_ERR_MEMORY_LIMIT_REACHED if the tape doesn't fit in the machine's 
+// space limits.
+    enum ss_tm_err
+ss_tm_simulation_resume(
+    struct ss_tm *self,
+    const uint64_t *tape,
+    size_t tape_size,
+    size_t tape_head,
+    uint64_t state,
+    uint64_t steps);
+
+// Moving the head left from the left-most cell leaves the machine untouched
+// and returns SS_TM_ERR_HEAD_FELL_OFF_TAPE. Likewise, if the tape needs to 
+// grow but would exceed the machine's space limits, the machine is left 
+// untouched and SS_TM_ERR_MEMORY_LIMIT_REACHED is returned, and if growing it
+// fails, SS_TM_ERR_ALLOCATION_FAILED.
     enum ss_tm_err
 ss_tm_simulation_step(
     struct ss_tm *self);
@@ -116,6 +380,8 @@ ss_tm_peek_tape_char(
     size_t in_position,
     uint64_t *out_char);
 
+// out_tape points at the machine's own tape, which moves when the tape 
+// grows. ss_tm_view.h has views that can tell when that's happened.
     enum ss_tm_err
 ss_tm_peek_tape_all(
     struct ss_tm *self,
@@ -131,6 +397,35 @@ ss_tm_peek_state(
 ss_tm_peek_head_pos(
     struct ss_tm *self,
     uint64_t *head_pos);
+
+// Number of steps taken since the simulation began.
+    enum ss_tm_err
+ss_tm_peek_steps(
+    struct ss_tm *self,
+    uint64_t *steps);
 // End configuration peeking definitions
 
-#endif // #ifndef ss_tm_h
\ No newline at end of file
+// Begin statistics definitions. Without SS_TM_STATS these all return
+// SS_TM_ERR_STATS_DISABLED.
+
+// Copies the counters to out_stats. If out_transition_hits isn't NULL, it
+// receives the hit count of each of the machine's transitions_end transitions.
+    enum ss_tm_err
+ss_tm_stats_snapshot(
+    struct ss_tm *self,
+    struct ss_tm_stats *out_stats,
+    uint64_t *out_transition_hits);
+
+    enum ss_tm_err
+ss_tm_stats_reset(
+    struct ss_tm *self);
+
+// Writes the counters and the hits of every transition taken at least once to
+// f in a human-readable form.
+    enum ss_tm_err
+ss_tm_stats_dump(
+    struct ss_tm *self,
+    FILE *f);
+// End statistics definitions
+
+#endif // #ifndef ss_tm_h
@@ -0,0 +1,1072 @@
+#include "ss_tm_accel.h"
+#include "ss_tm_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Shapes remembered at once. The history is forgotten when it fills up.
+#define SS_TM_ACCEL_HISTORY_SIZE 1024
+// Most macro steps a proof may replay.
+#define SS_TM_ACCEL_MAX_PROOF_STEPS 100000
+// Most times a proof is retried with a bigger base for some variable.
+#define SS_TM_ACCEL_MAX_PROOF_ATTEMPTS 64
+// Rules are looked for after macro steps that add or remove a run, and after
+// every macro step once the runs have gone this many unchanged.
+#define SS_TM_ACCEL_SETTLE_STEPS 16
+// Proofs may replay at most 1 / SS_TM_ACCEL_PROOF_SHARE as many macro steps
+// as have been simulated.
+#define SS_TM_ACCEL_PROOF_SHARE 8
+
+#define SS_TM_ACCEL_TRY(expr) do { \
+    enum ss_tm_err e_ = (expr); \
+    if(e_ != SS_TM_ERR_NO_ERROR) \
+        return e_; \
+} while(0)
+
+enum ss_tm_accel_result {
+    SS_TM_ACCEL_STEPPED,
+    SS_TM_ACCEL_HALTED,
+    SS_TM_ACCEL_FELL_OFF,
+    // The head is sweeping right over blanks forever.
+    SS_TM_ACCEL_FOREVER,
+    // Only while proving: what happens next depends on how big a variable
+    // is, beyond what its base guarantees.
+    SS_TM_ACCEL_UNDECIDED
+};
+
+// Begin expression definitions
+
+    static enum ss_tm_err
+ss_tm_accel_expr_init(
+    struct ss_tm_accel_expr *self,
+    size_t num_vars) {
+
+    ss_tm_bigint_init(&self->constant);
+    self->coefs = NULL;
+    if(num_vars) {
+        self->coefs = (int64_t *)calloc(num_vars, sizeof(int64_t));
+        if(!self->coefs)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static void
+ss_tm_accel_expr_destroy(
+    struct ss_tm_accel_expr *self) {
+
+    ss_tm_bigint_destroy(&self->constant);
+    free(self->coefs);
+}
+
+    static enum ss_tm_err
+ss_tm_accel_expr_add(
+    struct ss_tm_accel_expr *self,
+    const struct ss_tm_accel_expr *other,
+    size_t num_vars) {
+
+    size_t i;
+    for(i = 0; i < num_vars; i++)
+        self->coefs[i] += other->coefs[i];
+    return ss_tm_bigint_add(&self->constant, &self->constant, &other->constant);
+}
+
+// Returns the first variable in self, or SIZE_MAX if it's constant.
+    static size_t
+ss_tm_accel_expr_first_var(
+    const struct ss_tm_accel_expr *self,
+    size_t num_vars) {
+
+    size_t i;
+    for(i = 0; i < num_vars; i++) {
+        if(self->coefs[i] != 0)
+            return i;
+    }
+    return SIZE_MAX;
+}
+// End expression definitions
+
+// Begin tape definitions
+
+    static void
+ss_tm_accel_side_destroy(
+    struct ss_tm_accel_side *self) {
+
+    size_t i;
+    for(i = 0; i < self->end; i++)
+        ss_tm_accel_expr_destroy(&self->runs[i].count);
+    free(self->runs);
+    self->runs = NULL;
+    self->end = 0;
+    self->size = 0;
+}
+
+    static enum ss_tm_err
+ss_tm_accel_config_init(
+    struct ss_tm_accel_config *self,
+    size_t num_vars) {
+
+    memset(&self->left, 0, sizeof(self->left));
+    memset(&self->right, 0, sizeof(self->right));
+    self->head_symbol = 0;
+    self->state = SS_TM_INITIAL_STATE;
+    self->pending_steps = 0;
+    self->num_vars = num_vars;
+    self->reshaped = false;
+    return ss_tm_accel_expr_init(&self->steps, num_vars);
+}
+
+    static void
+ss_tm_accel_config_destroy(
+    struct ss_tm_accel_config *self) {
+
+    ss_tm_accel_side_destroy(&self->left);
+    ss_tm_accel_side_destroy(&self->right);
+    ss_tm_accel_expr_destroy(&self->steps);
+}
+
+// Run i of the tape, counting from the left end.
+    static struct ss_tm_accel_run *
+ss_tm_accel_run_at(
+    struct ss_tm_accel_config *self,
+    size_t i) {
+
+    if(i < self->left.end)
+        return &self->left.runs[i];
+    return &self->right.runs[self->right.end - 1 - (i - self->left.end)];
+}
+
+// Puts count cells of symbol on side, next to the head, merging them into the
+// run there if it has the same symbol. Takes ownership of count.
+    static enum ss_tm_err
+ss_tm_accel_push(
+    struct ss_tm_accel_config *self,
+    struct ss_tm_accel_side *side,
+    uint64_t symbol,
+    struct ss_tm_accel_expr *count) {
+
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    if(side == &self->right && side->end == 0 && symbol == 0) {
+        // Blanks past the right end are implied.
+    } else if(side->end > 0 && side->runs[side->end - 1].symbol == symbol) {
+        e = ss_tm_accel_expr_add(&side->runs[side->end - 1].count, count, self->num_vars);
+    } else {
+        if(side->end == side->size) {
+            size_t size = side->size ? side->size * 2 : 16;
+            struct ss_tm_accel_run *runs = (struct ss_tm_accel_run *)realloc(
+                side->runs, size * sizeof(struct ss_tm_accel_run));
+            if(!runs) {
+                ss_tm_accel_expr_destroy(count);
+                return SS_TM_ERR_ALLOCATION_FAILED;
+            }
+            side->runs = runs;
+            side->size = size;
+        }
+        side->runs[side->end].symbol = symbol;
+        side->runs[side->end].count = *count;
+        side->end++;
+        self->reshaped = true;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    ss_tm_accel_expr_destroy(count);
+    return e;
+}
+
+    static enum ss_tm_err
+ss_tm_accel_push_one(
+    struct ss_tm_accel_config *self,
+    struct ss_tm_accel_side *side,
+    uint64_t symbol) {
+
+    if(side->end > 0 && side->runs[side->end - 1].symbol == symbol) {
+        struct ss_tm_bigint *count = &side->runs[side->end - 1].count.constant;
+        return ss_tm_bigint_add_i64(count, count, 1);
+    }
+    struct ss_tm_accel_expr one;
+    SS_TM_ACCEL_TRY(ss_tm_accel_expr_init(&one, self->num_vars));
+    enum ss_tm_err e = ss_tm_bigint_set_u64(&one.constant, 1);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        ss_tm_accel_expr_destroy(&one);
+        return e;
+    }
+    return ss_tm_accel_push(self, side, symbol, &one);
+}
+
+// Takes the cell next to the head off side. The right side is blank past its
+// end; the left side mustn't be empty. If the run there has a variable length
+// that might be 1, nothing is taken and *out_undecided receives the variable.
+    static enum ss_tm_err
+ss_tm_accel_pop_one(
+    struct ss_tm_accel_config *self,
+    struct ss_tm_accel_side *side,
+    uint64_t *out_symbol,
+    size_t *out_undecided) {
+
+    *out_undecided = SIZE_MAX;
+    if(side->end == 0) {
+        *out_symbol = 0;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    struct ss_tm_accel_run *top = &side->runs[side->end - 1];
+    *out_symbol = top->symbol;
+    size_t var = ss_tm_accel_expr_first_var(&top->count, self->num_vars);
+    if(var != SIZE_MAX) {
+        // Variables are at least 0, so the run stays nonempty only if the
+        // constant does.
+        if(ss_tm_bigint_cmp_i64(&top->count.constant, 1) <= 0) {
+            *out_undecided = var;
+            return SS_TM_ERR_NO_ERROR;
+        }
+    } else if(ss_tm_bigint_cmp_i64(&top->count.constant, 1) == 0) {
+        ss_tm_accel_expr_destroy(&top->count);
+        side->end--;
+        self->reshaped = true;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    return ss_tm_bigint_add_i64(&top->count.constant, &top->count.constant, -1);
+}
+
+// Adds the pending single steps to steps.
+    static enum ss_tm_err
+ss_tm_accel_flush_steps(
+    struct ss_tm_accel_config *self) {
+
+    SS_TM_ACCEL_TRY(ss_tm_bigint_add_i64(
+        &self->steps.constant, &self->steps.constant, (int64_t)self->pending_steps));
+    self->pending_steps = 0;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static enum ss_tm_err
+ss_tm_accel_add_step(
+    struct ss_tm_accel_config *self) {
+
+    if(++self->pending_steps < INT64_MAX)
+        return SS_TM_ERR_NO_ERROR;
+    return ss_tm_accel_flush_steps(self);
+}
+
+// Takes one chain step or single step. Works the same on the tape being
+// simulated and on the symbolic tapes of proofs.
+    static enum ss_tm_err
+ss_tm_accel_macro_step(
+    const struct ss_tm *machine,
+    struct ss_tm_accel_config *self,
+    enum ss_tm_accel_result *out_result,
+    size_t *out_undecided,
+    bool *out_chained) {
+
+    *out_undecided = SIZE_MAX;
+    *out_chained = false;
+    if(self->state == SS_TM_ACCEPT_STATE || self->state == SS_TM_REJECT_STATE) {
+        *out_result = SS_TM_ACCEL_HALTED;
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    const struct ss_tm_transition *t;
+    size_t num_transitions;
+    ss_tm_find_transitions(machine, self->state, self->head_symbol, &t, &num_transitions);
+    if(num_transitions == 0) {
+        self->state = SS_TM_REJECT_STATE;
+        *out_result = SS_TM_ACCEL_HALTED;
+        return ss_tm_accel_add_step(self);
+    }
+
+    struct ss_tm_accel_side *ahead = t->out_right ? &self->right : &self->left;
+    struct ss_tm_accel_side *behind = t->out_right ? &self->left : &self->right;
+
+    if(t->out_state == self->state) {
+        if(t->out_right && ahead->end == 0 && self->head_symbol == 0) {
+            *out_result = SS_TM_ACCEL_FOREVER;
+            return SS_TM_ERR_NO_ERROR;
+        }
+        if(ahead->end > 0 && ahead->runs[ahead->end - 1].symbol == self->head_symbol) {
+            // The head crosses its own cell and the whole run ahead.
+            *out_chained = true;
+            struct ss_tm_accel_expr crossed = ahead->runs[--ahead->end].count;
+            self->reshaped = true;
+            if(!t->out_right && ahead->end == 0) {
+                // That run reaches the left end, so the head stops on the
+                // end cell, which it hasn't written, and falls off.
+                *out_result = SS_TM_ACCEL_FELL_OFF;
+                enum ss_tm_err e = ss_tm_accel_expr_add(&self->steps, &crossed, self->num_vars);
+                if(e != SS_TM_ERR_NO_ERROR) {
+                    ss_tm_accel_expr_destroy(&crossed);
+                    return e;
+                }
+                return ss_tm_accel_push(self, behind, t->out_char, &crossed);
+            }
+            enum ss_tm_err e = ss_tm_bigint_add_i64(&crossed.constant, &crossed.constant, 1);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_accel_expr_add(&self->steps, &crossed, self->num_vars);
+            if(e != SS_TM_ERR_NO_ERROR) {
+                ss_tm_accel_expr_destroy(&crossed);
+                return e;
+            }
+            SS_TM_ACCEL_TRY(ss_tm_accel_push(self, behind, t->out_char, &crossed));
+            SS_TM_ACCEL_TRY(ss_tm_accel_pop_one(self, ahead, &self->head_symbol, out_undecided));
+            *out_result = *out_undecided == SIZE_MAX ?
+                SS_TM_ACCEL_STEPPED : SS_TM_ACCEL_UNDECIDED;
+            return SS_TM_ERR_NO_ERROR;
+        }
+    }
+
+    if(!t->out_right && self->left.end == 0) {
+        *out_result = SS_TM_ACCEL_FELL_OFF;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    uint64_t next_symbol;
+    SS_TM_ACCEL_TRY(ss_tm_accel_pop_one(self, ahead, &next_symbol, out_undecided));
+    if(*out_undecided != SIZE_MAX) {
+        *out_result = SS_TM_ACCEL_UNDECIDED;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    SS_TM_ACCEL_TRY(ss_tm_accel_push_one(self, behind, t->out_char));
+    self->head_symbol = next_symbol;
+    self->state = t->out_state;
+    *out_result = self->state == SS_TM_ACCEPT_STATE || self->state == SS_TM_REJECT_STATE ?
+        SS_TM_ACCEL_HALTED : SS_TM_ACCEL_STEPPED;
+    return ss_tm_accel_add_step(self);
+}
+
+// Writes the shape of tape to self->key.
+    static enum ss_tm_err
+ss_tm_accel_make_key(
+    struct ss_tm_accel *self,
+    struct ss_tm_accel_config *tape,
+    size_t *out_key_size) {
+
+    size_t num_runs = tape->left.end + tape->right.end;
+    size_t key_size = 3 + num_runs;
+    if(key_size > self->key_capacity) {
+        uint64_t *key = (uint64_t *)realloc(self->key, key_size * 2 * sizeof(uint64_t));
+        if(!key)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        self->key = key;
+        self->key_capacity = key_size * 2;
+    }
+    self->key[0] = tape->state;
+    self->key[1] = tape->head_symbol;
+    self->key[2] = tape->left.end;
+    size_t i;
+    for(i = 0; i < num_runs; i++)
+        self->key[3 + i] = ss_tm_accel_run_at(tape, i)->symbol;
+    *out_key_size = key_size;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static size_t
+ss_tm_accel_key_slot(
+    const uint64_t *key,
+    size_t key_size,
+    size_t index_mask) {
+
+    return ss_tm_index_slot_multi(key[0], key + 1, key_size - 1, index_mask);
+}
+
+    static bool
+ss_tm_accel_key_equal(
+    const uint64_t *a,
+    size_t a_size,
+    const uint64_t *b,
+    size_t b_size) {
+
+    return a_size == b_size && memcmp(a, b, a_size * sizeof(uint64_t)) == 0;
+}
+// End tape definitions
+
+// Begin history definitions
+
+    static void
+ss_tm_accel_history_clear(
+    struct ss_tm_accel *self) {
+
+    size_t i;
+    for(i = 0; i < self->history_end; i++) {
+        struct ss_tm_accel_record *record = &self->history[i];
+        size_t j;
+        for(j = 0; j < record->key_size - 3; j++)
+            ss_tm_bigint_destroy(&record->counts[j]);
+        free(record->counts);
+        free(record->key);
+    }
+    self->history_end = 0;
+    memset(self->history_index, 0, 2 * SS_TM_ACCEL_HISTORY_SIZE * sizeof(size_t));
+}
+
+    static struct ss_tm_accel_record *
+ss_tm_accel_history_find(
+    struct ss_tm_accel *self,
+    size_t key_size) {
+
+    size_t mask = 2 * SS_TM_ACCEL_HISTORY_SIZE - 1;
+    size_t slot = ss_tm_accel_key_slot(self->key, key_size, mask);
+    size_t entry;
+    while((entry = self->history_index[slot]) != 0) {
+        struct ss_tm_accel_record *record = &self->history[entry - 1];
+        if(ss_tm_accel_key_equal(record->key, record->key_size, self->key, key_size))
+            return record;
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// Copies the tape's run lengths and the macro step count to record.
+    static enum ss_tm_err
+ss_tm_accel_history_update(
+    struct ss_tm_accel *self,
+    struct ss_tm_accel_record *record) {
+
+    size_t i;
+    for(i = 0; i < record->key_size - 3; i++) {
+        SS_TM_ACCEL_TRY(ss_tm_bigint_copy(
+            &record->counts[i], &ss_tm_accel_run_at(&self->tape, i)->count.constant));
+    }
+    record->macro_step = self->macro_steps;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Records the tape, whose key is in self->key.
+    static enum ss_tm_err
+ss_tm_accel_history_add(
+    struct ss_tm_accel *self,
+    size_t key_size) {
+
+    if(self->history_end == SS_TM_ACCEL_HISTORY_SIZE)
+        ss_tm_accel_history_clear(self);
+
+    struct ss_tm_accel_record *record = &self->history[self->history_end];
+    size_t num_runs = key_size - 3;
+    record->key = (uint64_t *)malloc(key_size * sizeof(uint64_t));
+    record->counts = (struct ss_tm_bigint *)malloc(
+        (num_runs ? num_runs : 1) * sizeof(struct ss_tm_bigint));
+    if(!record->key || !record->counts) {
+        free(record->key);
+        free(record->counts);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    memcpy(record->key, self->key, key_size * sizeof(uint64_t));
+    record->key_size = key_size;
+    size_t i;
+    for(i = 0; i < num_runs; i++)
+        ss_tm_bigint_init(&record->counts[i]);
+    self->history_end++;
+
+    size_t mask = 2 * SS_TM_ACCEL_HISTORY_SIZE - 1;
+    size_t slot = ss_tm_accel_key_slot(self->key, key_size, mask);
+    while(self->history_index[slot] != 0)
+        slot = (slot + 1) & mask;
+    self->history_index[slot] = self->history_end;
+
+    return ss_tm_accel_history_update(self, record);
+}
+// End history definitions
+
+// Begin rule definitions
+
+    static void
+ss_tm_accel_rule_destroy(
+    struct ss_tm_accel_rule *self) {
+
+    size_t i;
+    for(i = 0; i < self->num_runs; i++) {
+        ss_tm_bigint_destroy(&self->base[i]);
+        ss_tm_bigint_destroy(&self->delta[i]);
+    }
+    free(self->key);
+    free(self->variable);
+    free(self->base);
+    free(self->delta);
+    ss_tm_accel_expr_destroy(&self->steps);
+}
+
+    static bool
+ss_tm_accel_rule_applies(
+    struct ss_tm_accel *self,
+    const struct ss_tm_accel_rule *rule) {
+
+    size_t i;
+    for(i = 0; i < rule->num_runs; i++) {
+        int c = ss_tm_bigint_cmp(
+            &ss_tm_accel_run_at(&self->tape, i)->count.constant, &rule->base[i]);
+        if(rule->variable[i] ? c < 0 : c != 0)
+            return false;
+    }
+    return true;
+}
+
+// Returns a rule applying to the tape, whose key is in self->key, or NULL.
+    static struct ss_tm_accel_rule *
+ss_tm_accel_rule_find(
+    struct ss_tm_accel *self,
+    size_t key_size) {
+
+    size_t slot = ss_tm_accel_key_slot(self->key, key_size, self->rule_index_mask);
+    size_t entry;
+    while((entry = self->rule_index[slot]) != 0) {
+        struct ss_tm_accel_rule *rule = &self->rules[entry - 1];
+        if(ss_tm_accel_key_equal(rule->key, rule->key_size, self->key, key_size) &&
+            ss_tm_accel_rule_applies(self, rule)) {
+
+            return rule;
+        }
+        slot = (slot + 1) & self->rule_index_mask;
+    }
+    return NULL;
+}
+
+    static void
+ss_tm_accel_rule_index_insert(
+    struct ss_tm_accel *self,
+    size_t i) {
+
+    const struct ss_tm_accel_rule *rule = &self->rules[i];
+    size_t slot = ss_tm_accel_key_slot(rule->key, rule->key_size, self->rule_index_mask);
+    while(self->rule_index[slot] != 0)
+        slot = (slot + 1) & self->rule_index_mask;
+    self->rule_index[slot] = i + 1;
+}
+
+// Adds rule, taking ownership of it.
+    static enum ss_tm_err
+ss_tm_accel_rule_add(
+    struct ss_tm_accel *self,
+    struct ss_tm_accel_rule *rule) {
+
+    if(self->rules_end == self->rules_size) {
+        size_t size = self->rules_size * 2;
+        struct ss_tm_accel_rule *rules = (struct ss_tm_accel_rule *)realloc(
+            self->rules, size * sizeof(struct ss_tm_accel_rule));
+        if(!rules) {
+            ss_tm_accel_rule_destroy(rule);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        self->rules = rules;
+        self->rules_size = size;
+    }
+    if((self->rules_end + 1) * 2 > self->rule_index_mask + 1) {
+        size_t index_size = (self->rule_index_mask + 1) * 2;
+        size_t *index = (size_t *)calloc(index_size, sizeof(size_t));
+        if(!index) {
+            ss_tm_accel_rule_destroy(rule);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        free(self->rule_index);
+        self->rule_index = index;
+        self->rule_index_mask = index_size - 1;
+        size_t i;
+        for(i = 0; i < self->rules_end; i++)
+            ss_tm_accel_rule_index_insert(self, i);
+    }
+    self->rules[self->rules_end] = *rule;
+    ss_tm_accel_rule_index_insert(self, self->rules_end);
+    self->rules_end++;
+    self->rules_proved++;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Applies rule to the tape as many times as it can be in a row. If it can
+// be forever, leaves the tape alone and sets *out_forever.
+    static enum ss_tm_err
+ss_tm_accel_rule_apply(
+    struct ss_tm_accel *self,
+    const struct ss_tm_accel_rule *rule,
+    bool *out_forever) {
+
+    // Application j (from 0) starts with run i at count_i + j * delta_i, and
+    // needs that to be at least base_i. So the number of applications k is
+    // the least of (count_i - base_i) / -delta_i + 1 over shrinking runs.
+    struct ss_tm_bigint k;
+    struct ss_tm_bigint x;
+    struct ss_tm_bigint t;
+    struct ss_tm_bigint total;
+    ss_tm_bigint_init(&k);
+    ss_tm_bigint_init(&x);
+    ss_tm_bigint_init(&t);
+    ss_tm_bigint_init(&total);
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    bool bounded = false;
+    size_t i;
+    for(i = 0; i < rule->num_runs && e == SS_TM_ERR_NO_ERROR; i++) {
+        if(!rule->variable[i] || ss_tm_bigint_sign(&rule->delta[i]) >= 0)
+            continue;
+        struct ss_tm_bigint *count = &ss_tm_accel_run_at(&self->tape, i)->count.constant;
+        e = ss_tm_bigint_sub(&x, count, &rule->base[i]);
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_mul_i64(&t, &rule->delta[i], -1);
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_div(&t, &x, &t);
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_add_i64(&t, &t, 1);
+        if(e == SS_TM_ERR_NO_ERROR && (!bounded || ss_tm_bigint_cmp(&t, &k) < 0)) {
+            e = ss_tm_bigint_copy(&k, &t);
+            bounded = true;
+        }
+    }
+
+    *out_forever = !bounded;
+    if(bounded && e == SS_TM_ERR_NO_ERROR) {
+        // Steps: the sum over j < k of
+        //   constant + sum_i coef_i * (x_i + j * delta_i)
+        // = k * constant + sum_i coef_i * (k * x_i + delta_i * k * (k - 1) / 2).
+        struct ss_tm_bigint pairs;
+        ss_tm_bigint_init(&pairs);
+        e = ss_tm_bigint_add_i64(&pairs, &k, -1);
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_mul(&pairs, &pairs, &k);
+        if(e == SS_TM_ERR_NO_ERROR) {
+            ss_tm_bigint_set_u64(&t, 2);
+            e = ss_tm_bigint_div(&pairs, &pairs, &t);
+        }
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_mul(&total, &k, &rule->steps.constant);
+        for(i = 0; i < rule->num_runs && e == SS_TM_ERR_NO_ERROR; i++) {
+            if(!rule->variable[i] || rule->steps.coefs[i] == 0)
+                continue;
+            struct ss_tm_bigint *count = &ss_tm_accel_run_at(&self->tape, i)->count.constant;
+            e = ss_tm_bigint_sub(&x, count, &rule->base[i]);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_mul(&x, &x, &k);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_mul(&t, &rule->delta[i], &pairs);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_add(&x, &x, &t);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_mul_i64(&x, &x, rule->steps.coefs[i]);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_add(&total, &total, &x);
+        }
+        ss_tm_bigint_destroy(&pairs);
+        if(e == SS_TM_ERR_NO_ERROR)
+            e = ss_tm_bigint_add(&self->tape.steps.constant, &self->tape.steps.constant, &total);
+
+        for(i = 0; i < rule->num_runs && e == SS_TM_ERR_NO_ERROR; i++) {
+            if(!rule->variable[i])
+                continue;
+            struct ss_tm_bigint *count = &ss_tm_accel_run_at(&self->tape, i)->count.constant;
+            e = ss_tm_bigint_mul(&t, &rule->delta[i], &k);
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_bigint_add(count, count, &t);
+        }
+    }
+
+    ss_tm_bigint_destroy(&k);
+    ss_tm_bigint_destroy(&x);
+    ss_tm_bigint_destroy(&t);
+    ss_tm_bigint_destroy(&total);
+    return e;
+}
+
+// Builds the symbolic tape for record's shape: run i is base[i] plus
+// variable i if variable[i], and exactly base[i] otherwise.
+    static enum ss_tm_err
+ss_tm_accel_symbolic_tape(
+    const struct ss_tm_accel_record *record,
+    const bool *variable,
+    const struct ss_tm_bigint *base,
+    struct ss_tm_accel_config *out_tape) {
+
+    size_t num_runs = record->key_size - 3;
+    SS_TM_ACCEL_TRY(ss_tm_accel_config_init(out_tape, num_runs));
+    out_tape->state = record->key[0];
+    out_tape->head_symbol = record->key[1];
+    size_t num_left = record->key[2];
+
+    // The right side's runs are stacked from the far end.
+    size_t i;
+    for(i = 0; i < num_runs; i++) {
+        size_t run = i < num_left ? i : num_runs - 1 - (i - num_left);
+        struct ss_tm_accel_side *side = run < num_left ? &out_tape->left : &out_tape->right;
+        struct ss_tm_accel_expr count;
+        SS_TM_ACCEL_TRY(ss_tm_accel_expr_init(&count, num_runs));
+        enum ss_tm_err e = ss_tm_bigint_copy(&count.constant, &base[run]);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            ss_tm_accel_expr_destroy(&count);
+            return e;
+        }
+        if(variable[run])
+            count.coefs[run] = 1;
+        // Adjacent runs of a shape never share a symbol, so this doesn't
+        // merge.
+        SS_TM_ACCEL_TRY(ss_tm_accel_push(out_tape, side, record->key[3 + run], &count));
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Checks that tape, num_steps macro steps on from the start of a proof, is
+// back in the starting shape with each run's length changed by a constant,
+// and if so fills in rule.
+    static enum ss_tm_err
+ss_tm_accel_symbolic_check(
+    struct ss_tm_accel *self,
+    const struct ss_tm_accel_record *record,
+    struct ss_tm_accel_config *tape,
+    bool *variable,
+    struct ss_tm_bigint *base,
+    struct ss_tm_accel_rule *out_rule,
+    bool *out_proved) {
+
+    *out_proved = false;
+    size_t key_size;
+    SS_TM_ACCEL_TRY(ss_tm_accel_make_key(self, tape, &key_size));
+    if(!ss_tm_accel_key_equal(self->key, key_size, record->key, record->key_size))
+        return SS_TM_ERR_NO_ERROR;
+
+    size_t num_runs = key_size - 3;
+    size_t i;
+    for(i = 0; i < num_runs; i++) {
+        const struct ss_tm_accel_expr *count = &ss_tm_accel_run_at(tape, i)->count;
+        size_t j;
+        for(j = 0; j < num_runs; j++) {
+            if(count->coefs[j] != (j == i && variable[i]))
+                return SS_TM_ERR_NO_ERROR;
+        }
+        if(!variable[i] && ss_tm_bigint_cmp(&count->constant, &base[i]) != 0)
+            return SS_TM_ERR_NO_ERROR;
+    }
+
+    SS_TM_ACCEL_TRY(ss_tm_accel_flush_steps(tape));
+    memset(out_rule, 0, sizeof(*out_rule));
+    out_rule->num_runs = num_runs;
+    out_rule->key_size = key_size;
+    out_rule->key = (uint64_t *)malloc(key_size * sizeof(uint64_t));
+    out_rule->delta = (struct ss_tm_bigint *)calloc(num_runs + 1, sizeof(struct ss_tm_bigint));
+    if(!out_rule->key || !out_rule->delta) {
+        free(out_rule->key);
+        free(out_rule->delta);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    memcpy(out_rule->key, record->key, key_size * sizeof(uint64_t));
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    for(i = 0; i < num_runs && e == SS_TM_ERR_NO_ERROR; i++) {
+        if(variable[i]) {
+            const struct ss_tm_accel_expr *count = &ss_tm_accel_run_at(tape, i)->count;
+            e = ss_tm_bigint_sub(&out_rule->delta[i], &count->constant, &base[i]);
+        }
+    }
+    if(e != SS_TM_ERR_NO_ERROR) {
+        for(i = 0; i < num_runs; i++)
+            ss_tm_bigint_destroy(&out_rule->delta[i]);
+        free(out_rule->key);
+        free(out_rule->delta);
+        return e;
+    }
+    // The rule takes over the proof's arrays and step expression.
+    out_rule->variable = variable;
+    out_rule->base = base;
+    out_rule->steps = tape->steps;
+    ss_tm_accel_expr_init(&tape->steps, 0);
+    *out_proved = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Tries to prove a rule taking the tape from record's shape back to it, over
+// the macro steps since record was made.
+    static enum ss_tm_err
+ss_tm_accel_prove(
+    struct ss_tm_accel *self,
+    const struct ss_tm_accel_record *record,
+    struct ss_tm_accel_rule *out_rule,
+    bool *out_proved) {
+
+    *out_proved = false;
+    uint64_t num_steps = self->macro_steps - record->macro_step;
+    if(num_steps == 0 || num_steps > SS_TM_ACCEL_MAX_PROOF_STEPS)
+        return SS_TM_ERR_NO_ERROR;
+
+    // Runs whose lengths changed get variables, starting from the most
+    // general base of 1. A run that has to be longer for the proof to go
+    // through gets its base doubled, up to its length now, so that the rule
+    // still applies here.
+    size_t num_runs = record->key_size - 3;
+    bool *variable = (bool *)malloc((num_runs ? num_runs : 1) * sizeof(bool));
+    struct ss_tm_bigint *base = (struct ss_tm_bigint *)calloc(
+        num_runs + 1, sizeof(struct ss_tm_bigint));
+    if(!variable || !base) {
+        free(variable);
+        free(base);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    size_t i;
+    for(i = 0; i < num_runs && e == SS_TM_ERR_NO_ERROR; i++) {
+        const struct ss_tm_bigint *now = &ss_tm_accel_run_at(&self->tape, i)->count.constant;
+        variable[i] = ss_tm_bigint_cmp(&record->counts[i], now) != 0;
+        e = variable[i] ?
+            ss_tm_bigint_set_u64(&base[i], 1) : ss_tm_bigint_copy(&base[i], now);
+    }
+
+    int attempt;
+    for(attempt = 0; attempt < SS_TM_ACCEL_MAX_PROOF_ATTEMPTS && e == SS_TM_ERR_NO_ERROR; attempt++) {
+        struct ss_tm_accel_config tape;
+        e = ss_tm_accel_symbolic_tape(record, variable, base, &tape);
+        enum ss_tm_accel_result result = SS_TM_ACCEL_STEPPED;
+        size_t undecided = SIZE_MAX;
+        uint64_t step;
+        for(step = 0; step < num_steps && e == SS_TM_ERR_NO_ERROR; step++) {
+            bool chained;
+            e = ss_tm_accel_macro_step(self->machine, &tape, &result, &undecided, &chained);
+            self->proof_steps++;
+            if(result != SS_TM_ACCEL_STEPPED)
+                break;
+        }
+        if(e == SS_TM_ERR_NO_ERROR && result == SS_TM_ACCEL_STEPPED) {
+            e = ss_tm_accel_symbolic_check(
+                self, record, &tape, variable, base, out_rule, out_proved);
+        }
+        ss_tm_accel_config_destroy(&tape);
+        if(*out_proved)
+            return e;
+        if(e != SS_TM_ERR_NO_ERROR || result != SS_TM_ACCEL_UNDECIDED)
+            break;
+
+        const struct ss_tm_bigint *now =
+            &ss_tm_accel_run_at(&self->tape, undecided)->count.constant;
+        if(!variable[undecided] || ss_tm_bigint_cmp(&base[undecided], now) >= 0)
+            break;
+        e = ss_tm_bigint_mul_i64(&base[undecided], &base[undecided], 2);
+        if(e == SS_TM_ERR_NO_ERROR && ss_tm_bigint_cmp(&base[undecided], now) > 0)
+            e = ss_tm_bigint_copy(&base[undecided], now);
+    }
+
+    for(i = 0; i < num_runs; i++)
+        ss_tm_bigint_destroy(&base[i]);
+    free(base);
+    free(variable);
+    return e;
+}
+
+// Applies a rule to the tape if one applies, proving one first if the shape
+// has come up before. Sets *out_applied if one was.
+    static enum ss_tm_err
+ss_tm_accel_try_rules(
+    struct ss_tm_accel *self,
+    bool *out_applied) {
+
+    *out_applied = false;
+    size_t key_size;
+    SS_TM_ACCEL_TRY(ss_tm_accel_make_key(self, &self->tape, &key_size));
+
+    struct ss_tm_accel_rule *rule = ss_tm_accel_rule_find(self, key_size);
+    if(!rule) {
+        struct ss_tm_accel_record *record = ss_tm_accel_history_find(self, key_size);
+        if(!record)
+            return ss_tm_accel_history_add(self, key_size);
+        // A shape that keeps coming back without a rule, like a digit
+        // pattern of a counter, would otherwise be replayed every time.
+        uint64_t replay = self->macro_steps - record->macro_step;
+        if(self->proof_steps + replay > self->macro_steps / SS_TM_ACCEL_PROOF_SHARE)
+            return ss_tm_accel_history_update(self, record);
+
+        struct ss_tm_accel_rule proved;
+        bool is_proved;
+        SS_TM_ACCEL_TRY(ss_tm_accel_prove(self, record, &proved, &is_proved));
+        if(!is_proved)
+            return ss_tm_accel_history_update(self, record);
+        SS_TM_ACCEL_TRY(ss_tm_accel_rule_add(self, &proved));
+        rule = &self->rules[self->rules_end - 1];
+    }
+
+    bool forever;
+    SS_TM_ACCEL_TRY(ss_tm_accel_rule_apply(self, rule, &forever));
+    if(forever)
+        self->never_halts = true;
+    // Macro steps since a record are only comparable if no rule was applied
+    // in between.
+    ss_tm_accel_history_clear(self);
+    self->macro_steps++;
+    self->rule_applications++;
+    *out_applied = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+// End rule definitions
+
+    enum ss_tm_err
+ss_tm_accel_init(
+    struct ss_tm_accel *self,
+    const struct ss_tm *machine,
+    size_t max_rule_runs) {
+
+    if(!machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    if(machine->nondeterministic)
+        return SS_TM_ERR_NONDETERMINISTIC_MACHINE;
+
+    memset(self, 0, sizeof(*self));
+    self->machine = machine;
+    self->max_rule_runs = max_rule_runs;
+    self->rules = (struct ss_tm_accel_rule *)malloc(16 * sizeof(struct ss_tm_accel_rule));
+    self->rule_index = (size_t *)calloc(32, sizeof(size_t));
+    self->history = (struct ss_tm_accel_record *)malloc(
+        SS_TM_ACCEL_HISTORY_SIZE * sizeof(struct ss_tm_accel_record));
+    self->history_index = (size_t *)calloc(2 * SS_TM_ACCEL_HISTORY_SIZE, sizeof(size_t));
+    enum ss_tm_err e = ss_tm_accel_config_init(&self->tape, 0);
+    if(!self->rules || !self->rule_index || !self->history || !self->history_index ||
+        e != SS_TM_ERR_NO_ERROR) {
+
+        free(self->rules);
+        free(self->rule_index);
+        free(self->history);
+        free(self->history_index);
+        ss_tm_accel_config_destroy(&self->tape);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->rules_size = 16;
+    self->rule_index_mask = 31;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_accel_destroy(
+    struct ss_tm_accel *self) {
+
+    size_t i;
+    for(i = 0; i < self->rules_end; i++)
+        ss_tm_accel_rule_destroy(&self->rules[i]);
+    free(self->rules);
+    free(self->rule_index);
+    ss_tm_accel_history_clear(self);
+    free(self->history);
+    free(self->history_index);
+    ss_tm_accel_config_destroy(&self->tape);
+    free(self->key);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_accel_begin(
+    struct ss_tm_accel *self,
+    const uint64_t *input_string,
+    size_t input_string_size) {
+
+    SS_TM_ACCEL_TRY(ss_tm_validate_input(input_string, input_string_size));
+
+    self->simulation_started = false;
+    ss_tm_accel_config_destroy(&self->tape);
+    SS_TM_ACCEL_TRY(ss_tm_accel_config_init(&self->tape, 0));
+    self->tape.head_symbol = input_string_size ? input_string[0] : 0;
+    size_t i = input_string_size;
+    while(i > 1) {
+        i--;
+        SS_TM_ACCEL_TRY(ss_tm_accel_push_one(&self->tape, &self->tape.right, input_string[i]));
+    }
+
+    ss_tm_accel_history_clear(self);
+    self->never_halts = false;
+    self->tape.reshaped = true;
+    self->macro_steps = 0;
+    self->chain_steps = 0;
+    self->proof_steps = 0;
+    self->rule_applications = 0;
+    self->simulation_started = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static enum ss_tm_err
+ss_tm_accel_run_macro_steps(
+    struct ss_tm_accel *self,
+    uint64_t max_macro_steps,
+    enum ss_tm_outcome *out_outcome) {
+
+    uint64_t i;
+    for(i = 0; ; i++) {
+        if(self->never_halts) {
+            *out_outcome = SS_TM_OUTCOME_CLASSIFIED;
+            return SS_TM_ERR_NO_ERROR;
+        } else if(self->tape.state == SS_TM_ACCEPT_STATE) {
+            *out_outcome = SS_TM_OUTCOME_ACCEPT;
+            return SS_TM_ERR_NO_ERROR;
+        } else if(self->tape.state == SS_TM_REJECT_STATE) {
+            *out_outcome = SS_TM_OUTCOME_REJECT;
+            return SS_TM_ERR_NO_ERROR;
+        } else if(i == max_macro_steps) {
+            *out_outcome = SS_TM_OUTCOME_TIMEOUT;
+            return SS_TM_ERR_NO_ERROR;
+        }
+
+        if(self->tape.reshaped) {
+            self->tape.reshaped = false;
+            self->steps_since_reshape = 0;
+        }
+        if((self->steps_since_reshape == 0 ||
+                self->steps_since_reshape >= SS_TM_ACCEL_SETTLE_STEPS) &&
+            (!self->max_rule_runs ||
+                self->tape.left.end + self->tape.right.end <= self->max_rule_runs)) {
+
+            bool applied;
+            SS_TM_ACCEL_TRY(ss_tm_accel_try_rules(self, &applied));
+            if(applied)
+                continue;
+        }
+
+        enum ss_tm_accel_result result;
+        size_t undecided;
+        bool chained;
+        SS_TM_ACCEL_TRY(ss_tm_accel_macro_step(
+            self->machine, &self->tape, &result, &undecided, &chained));
+        self->macro_steps++;
+        self->chain_steps += chained;
+        self->steps_since_reshape++;
+        if(result == SS_TM_ACCEL_FELL_OFF) {
+            *out_outcome = SS_TM_OUTCOME_ERROR;
+            return SS_TM_ERR_HEAD_FELL_OFF_TAPE;
+        } else if(result == SS_TM_ACCEL_FOREVER) {
+            self->never_halts = true;
+        }
+    }
+}
+
+    enum ss_tm_err
+ss_tm_accel_run(
+    struct ss_tm_accel *self,
+    uint64_t max_macro_steps,
+    enum ss_tm_outcome *out_outcome) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    enum ss_tm_err e = ss_tm_accel_run_macro_steps(self, max_macro_steps, out_outcome);
+    enum ss_tm_err flush_e = ss_tm_accel_flush_steps(&self->tape);
+    return e != SS_TM_ERR_NO_ERROR ? e : flush_e;
+}
+
+    static void
+ss_tm_accel_dump_run(
+    FILE *f,
+    const struct ss_tm_accel_run *run) {
+
+    fprintf(f, " %" PRIu64, run->symbol);
+    if(ss_tm_bigint_cmp_i64(&run->count.constant, 1) != 0) {
+        char *count;
+        if(ss_tm_bigint_to_str(&run->count.constant, &count) == SS_TM_ERR_NO_ERROR) {
+            fprintf(f, "^%s", count);
+            free(count);
+        }
+    }
+}
+
+    enum ss_tm_err
+ss_tm_accel_dump(
+    struct ss_tm_accel *self,
+    FILE *f) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    SS_TM_ACCEL_TRY(ss_tm_accel_flush_steps(&self->tape));
+    char *steps;
+    SS_TM_ACCEL_TRY(ss_tm_bigint_to_str(&self->tape.steps.constant, &steps));
+    fprintf(f, "state %" PRIu64 ", step %s:", self->tape.state, steps);
+    free(steps);
+    size_t i;
+    for(i = 0; i < self->tape.left.end; i++)
+        ss_tm_accel_dump_run(f, &self->tape.left.runs[i]);
+    fprintf(f, " [%" PRIu64 "]", self->tape.head_symbol);
+    i = self->tape.right.end;
+    while(i > 0) {
+        i--;
+        ss_tm_accel_dump_run(f, &self->tape.right.runs[i]);
+    }
+    fprintf(f, "\n");
+    return SS_TM_ERR_NO_ERROR;
+}
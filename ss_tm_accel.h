@@ -0,0 +1,190 @@
+#ifndef ss_tm_accel_h
+#define ss_tm_accel_h
+
+#include "ss_tm.h"
+#include "ss_tm_bigint.h"
+
+// Simulates some machines far faster than step by step, on a tape compressed
+// into runs like 1^n 0 1^m, with run lengths and the step count as bigints.
+// A machine's transitions mean exactly what they do to ss_tm_simulation_step;
+// only the bookkeeping differs.
+//
+// Two kinds of shortcut are taken:
+//
+// - Chain steps. If the transition for the symbol under the head keeps the
+//   state and moves onto a run of that same symbol, the head crosses the
+//   whole run at once, however long it is.
+//
+// - Rules. When the tape comes back to a shape (state, symbol under the
+//   head, and the symbol of every run) it had a few steps ago, the run
+//   lengths that changed are replaced by variables and those steps are
+//   simulated again symbolically. If that comes back to the same shape with
+//   each varying length changed by a constant, it proves a rule: from any
+//   tape of that shape whose lengths are big enough, the same steps add
+//   those constants, in a number of steps linear in the lengths. A rule is
+//   then applied as many times as it can be at once, in closed form, and
+//   kept for whenever the shape comes up again. A rule that no length
+//   shrinks under applies forever, which proves the machine never halts.
+//
+// Shapes are only compared after macro steps that add or remove a run, or
+// once the runs have stopped changing, and proofs may replay only a small
+// share of the macro steps simulated, so a machine that proves no rules
+// doesn't spend most of its time trying to.
+//
+// So what gets faster is machines whose every loop is a single sweep: blank
+// sweeps and other chains, exact cycles, and linear loops like a unary
+// doubler that moves one mark per pass over its counts (bb4 also proves a
+// couple of these). Only rules from a shape back to itself are proved, and
+// rules don't nest, so a loop whose passes themselves need a rule to
+// shortcut is simulated a chain step at a time. That rules out binary
+// counters, including ss_tm_bench.c's left_edge_counter, and Collatz-like
+// machines such as bb5, whose tape also grows far past
+// SS_TM_ACCEL_DEFAULT_MAX_RULE_RUNS runs. They come out right, and bb5's long
+// chains still make it much faster than ss_tm_simulation_step, but a
+// counter's chains are short, so there ss_tm_simulation_step is faster.
+
+// A max_rule_runs for ss_tm_accel_init that keeps the cost of looking for
+// rules small next to that of the steps they'd save.
+#define SS_TM_ACCEL_DEFAULT_MAX_RULE_RUNS 32
+
+// A run length in a rule proof: constant + sum of coefs[i] * variable i.
+// Lengths on the tape being simulated are just constants, with no coefs.
+struct ss_tm_accel_expr {
+    struct ss_tm_bigint constant;
+    int64_t *coefs;
+};
+
+struct ss_tm_accel_run {
+    uint64_t symbol;
+    struct ss_tm_accel_expr count;
+};
+
+// One side of the head. runs[end - 1] is next to the head.
+struct ss_tm_accel_side {
+    struct ss_tm_accel_run *runs;
+    size_t end;
+    size_t size;
+};
+
+struct ss_tm_accel_config {
+    // runs[0] starts at the left end of the tape.
+    struct ss_tm_accel_side left;
+    // Past runs[0], the tape is blank forever; runs[0] is never blank.
+    struct ss_tm_accel_side right;
+    uint64_t head_symbol;
+    uint64_t state;
+    // Up to date whenever ss_tm_accel_run returns. Single steps are counted
+    // in pending_steps first, and only added to steps now and then.
+    struct ss_tm_accel_expr steps;
+    uint64_t pending_steps;
+    // Variables in the expressions; 0 on the tape being simulated.
+    size_t num_vars;
+    // Set whenever a run is added or removed.
+    bool reshaped;
+};
+
+// A proven rule. Run i is the i'th of the shape's runs, counting from the
+// left end of the tape.
+struct ss_tm_accel_rule {
+    // The shape: state, head symbol, number of runs left of the head, then
+    // each run's symbol.
+    uint64_t *key;
+    size_t key_size;
+    size_t num_runs;
+    // Whether each run's length varies. Those that don't must be exactly
+    // base; those that do must be at least base, and change by delta.
+    bool *variable;
+    struct ss_tm_bigint *base;
+    struct ss_tm_bigint *delta;
+    // Steps per application, with variable i being run i's length - base.
+    struct ss_tm_accel_expr steps;
+};
+
+// A shape seen since the last rule was applied, and its run lengths then.
+struct ss_tm_accel_record {
+    uint64_t *key;
+    size_t key_size;
+    struct ss_tm_bigint *counts;
+    uint64_t macro_step;
+};
+
+struct ss_tm_accel {
+    const struct ss_tm *machine;
+    // Most runs a tape may have for rules to be looked for on it; 0 for no
+    // limit.
+    size_t max_rule_runs;
+
+    bool simulation_started;
+    struct ss_tm_accel_config tape;
+    // Set once a rule or chain step proves the machine runs forever.
+    bool never_halts;
+
+    struct ss_tm_accel_rule *rules;
+    size_t rules_end;
+    size_t rules_size;
+    // Open-addressed hash of rule keys -> 1 + index into rules.
+    size_t *rule_index;
+    size_t rule_index_mask;
+
+    struct ss_tm_accel_record *history;
+    size_t history_end;
+    // Open-addressed hash of record keys -> 1 + index into history.
+    size_t *history_index;
+
+    // Scratch for the current shape's key.
+    uint64_t *key;
+    size_t key_capacity;
+    // Macro steps since a run was last added or removed.
+    uint64_t steps_since_reshape;
+
+    // Chain and single steps since the simulation began; rule applications
+    // count as one each.
+    uint64_t macro_steps;
+    uint64_t chain_steps;
+    // Macro steps replayed symbolically by proofs, successful or not.
+    uint64_t proof_steps;
+    uint64_t rules_proved;
+    uint64_t rule_applications;
+};
+
+// machine must be initialized and deterministic, and must outlive self. Rules
+// are only looked for while the tape has at most max_rule_runs runs (0 for no
+// limit): every macro step then costs time linear in the number of runs.
+    enum ss_tm_err
+ss_tm_accel_init(
+    struct ss_tm_accel *self,
+    const struct ss_tm *machine,
+    size_t max_rule_runs);
+
+    enum ss_tm_err
+ss_tm_accel_destroy(
+    struct ss_tm_accel *self);
+
+// Starts a simulation like ss_tm_simulation_begin. Rules proven in earlier
+// simulations are kept.
+    enum ss_tm_err
+ss_tm_accel_begin(
+    struct ss_tm_accel *self,
+    const uint64_t *input_string,
+    size_t input_string_size);
+
+// Simulates for up to max_macro_steps chain steps, single steps and rule
+// applications. out_outcome receives ACCEPT or REJECT if the machine halted,
+// CLASSIFIED if it was proven never to halt, TIMEOUT if neither happened in
+// time, and ERROR if the head fell off the left end of the tape, in which
+// case SS_TM_ERR_HEAD_FELL_OFF_TAPE is also returned. As with
+// ss_tm_simulation_step, the step that would fall off isn't counted.
+    enum ss_tm_err
+ss_tm_accel_run(
+    struct ss_tm_accel *self,
+    uint64_t max_macro_steps,
+    enum ss_tm_outcome *out_outcome);
+
+// Writes the state, step count and run-length encoded tape to f, like
+// "state 3, step 1234: 1^5 2 [1] 0^7 1", the head's cell in brackets.
+    enum ss_tm_err
+ss_tm_accel_dump(
+    struct ss_tm_accel *self,
+    FILE *f);
+
+#endif // #ifndef ss_tm_accel_h
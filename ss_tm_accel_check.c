@@ -0,0 +1,315 @@
+// Checks ss_tm_accel_run against ss_tm_simulation_step: runs the busy beavers
+// and a stream of random machines both ways, and reports any machine where
+// they disagree on the outcome, the step count or the final tape. Exits with
+// status 1 if there were any. Build with optimizations, e.g.
+//   cc -std=gnu11 -O2 ss_tm_accel_check.c ss_tm.c ss_tm_accel.c ss_tm_bigint.c -o ss_tm_accel_check
+// and run with no arguments, or with the number of random machines and a seed.
+
+#include "ss_tm.h"
+#include "ss_tm_accel.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// As in ss_tm_bench.c, two-way-tape machines start at the end of a run of
+// padding cells that behaves exactly like a blank, walked over by a preamble
+// state.
+#define CHECK_PADDING_CHAR 100ull
+#define CHECK_PADDING_CELLS (1u << 16)
+#define CHECK_PREAMBLE_STATE SS_TM_INITIAL_STATE
+// State letter A maps to this state, B to the one after, and so on.
+#define CHECK_FIRST_LETTER_STATE 1ull
+
+// Bounds for the random machines, which start on 1 to 8 cells of padding.
+// Steps for ss_tm_simulation_step, macro steps for ss_tm_accel_run.
+#define CHECK_MAX_STEPS 1000000
+#define CHECK_MAX_MACRO_STEPS 100000
+#define CHECK_MAX_RANDOM_PADDING 8
+
+struct check_totals {
+    unsigned machines;
+    unsigned halted;
+    unsigned fell_off;
+    unsigned classified;
+    unsigned timed_out;
+    unsigned mismatches;
+    uint64_t rules_proved;
+};
+
+// xorshift, so a seed always gives the same machines.
+    static uint64_t
+check_random(
+    uint64_t *x) {
+
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+// Adds in_state's transition on in_char, and on the padding too if in_char is
+// blank.
+    static void
+check_add_transition(
+    struct ss_tm *tm,
+    struct ss_tm_transition trans) {
+
+    ss_tm_add_state_transition(tm, trans);
+    if(trans.in_char == 0) {
+        trans.in_char = CHECK_PADDING_CHAR;
+        ss_tm_add_state_transition(tm, trans);
+    }
+}
+
+// Adds the preamble, which walks over the padding and then acts as state A
+// would on the first blank.
+    static void
+check_add_preamble(
+    struct ss_tm *tm,
+    struct ss_tm_transition start) {
+
+    struct ss_tm_transition walk = {
+        CHECK_PREAMBLE_STATE, CHECK_PADDING_CHAR, CHECK_PREAMBLE_STATE, CHECK_PADDING_CHAR, true};
+    ss_tm_add_state_transition(tm, walk);
+    start.in_state = CHECK_PREAMBLE_STATE;
+    start.in_char = 0;
+    ss_tm_add_state_transition(tm, start);
+}
+
+// Adds a two-symbol machine in the usual compact notation, e.g.
+// "1RB1LB_1LA1RZ", where Z is the halt state.
+    static void
+check_add_compact_machine(
+    struct ss_tm *tm,
+    const char *compact) {
+
+    uint64_t state = CHECK_FIRST_LETTER_STATE;
+    const char *p = compact;
+    while(*p) {
+        uint64_t in_char;
+        for(in_char = 0; in_char < 2; in_char++, p += 3) {
+            if(p[0] == '-')
+                continue;
+            struct ss_tm_transition trans;
+            trans.in_state = state;
+            trans.in_char = in_char;
+            trans.out_char = p[0] - '0';
+            trans.out_right = p[1] == 'R';
+            trans.out_state = p[2] == 'Z' || p[2] == 'H' ?
+                SS_TM_ACCEPT_STATE : CHECK_FIRST_LETTER_STATE + (p[2] - 'A');
+            if(state == CHECK_FIRST_LETTER_STATE && in_char == 0)
+                check_add_preamble(tm, trans);
+            check_add_transition(tm, trans);
+        }
+        if(*p == '_')
+            p++;
+        state++;
+    }
+}
+
+// Adds a machine with 2 to 4 states and 2 or 3 symbols. Each transition is
+// missing (rejecting), halting, or random, so most machines halt, fall off or
+// settle into something the accelerator can classify.
+    static void
+check_add_random_machine(
+    struct ss_tm *tm,
+    uint64_t *x) {
+
+    uint64_t num_states = 2 + check_random(x) % 3;
+    uint64_t num_symbols = 2 + check_random(x) % 2;
+    uint64_t state;
+    for(state = 0; state < num_states; state++) {
+        uint64_t in_char;
+        for(in_char = 0; in_char < num_symbols; in_char++) {
+            uint64_t r = check_random(x);
+            struct ss_tm_transition trans;
+            trans.in_state = CHECK_FIRST_LETTER_STATE + state;
+            trans.in_char = in_char;
+            trans.out_char = (r >> 8) % num_symbols;
+            trans.out_right = (r >> 16) & 1;
+            switch(r % 16) {
+                case 0:
+                    continue;
+                case 1:
+                    trans.out_state = SS_TM_ACCEPT_STATE;
+                    break;
+                default:
+                    trans.out_state = CHECK_FIRST_LETTER_STATE + (r >> 24) % num_states;
+                    break;
+            }
+            if(state == 0 && in_char == 0)
+                check_add_preamble(tm, trans);
+            check_add_transition(tm, trans);
+        }
+    }
+}
+
+// Whether the accelerator's tape, expanded, is the simulator's tape.
+    static bool
+check_tapes_match(
+    struct ss_tm_accel *accel,
+    struct ss_tm *tm) {
+
+    uint64_t *tape;
+    size_t tape_size;
+    uint64_t head;
+    ss_tm_peek_tape_all(tm, &tape, &tape_size);
+    ss_tm_peek_head_pos(tm, &head);
+
+    const struct ss_tm_accel_config *config = &accel->tape;
+    size_t pos = 0;
+    size_t i;
+    for(i = 0; i < config->left.end + 1 + config->right.end; i++) {
+        uint64_t symbol;
+        uint64_t count;
+        if(i < config->left.end) {
+            symbol = config->left.runs[i].symbol;
+            if(ss_tm_bigint_to_u64(&config->left.runs[i].count.constant, &count) != SS_TM_ERR_NO_ERROR)
+                return false;
+        } else if(i == config->left.end) {
+            if(pos != head)
+                return false;
+            symbol = config->head_symbol;
+            count = 1;
+        } else {
+            const struct ss_tm_accel_run *run =
+                &config->right.runs[config->right.end - 1 - (i - config->left.end - 1)];
+            symbol = run->symbol;
+            if(ss_tm_bigint_to_u64(&run->count.constant, &count) != SS_TM_ERR_NO_ERROR)
+                return false;
+        }
+        for(; count > 0; count--, pos++) {
+            if((pos < tape_size ? tape[pos] : 0) != symbol)
+                return false;
+        }
+    }
+    // The accelerator drops the blanks at the right end.
+    for(; pos < tape_size; pos++) {
+        if(tape[pos] != 0)
+            return false;
+    }
+    return true;
+}
+
+// Runs the machine both ways and checks they agree as far as both got.
+// Returns false on a mismatch.
+    static bool
+check_machine(
+    struct ss_tm *tm,
+    uint64_t *input,
+    size_t input_size,
+    uint64_t max_steps,
+    uint64_t max_macro_steps,
+    struct check_totals *totals) {
+
+    ss_tm_simulation_begin(tm, input, input_size);
+    enum ss_tm_err step_err = ss_tm_simulation_step_multiple(tm, max_steps);
+    uint64_t steps;
+    uint64_t state;
+    ss_tm_peek_steps(tm, &steps);
+    ss_tm_peek_state(tm, &state);
+    bool fell_off = step_err == SS_TM_ERR_HEAD_FELL_OFF_TAPE;
+    bool halted = state == SS_TM_ACCEPT_STATE || state == SS_TM_REJECT_STATE;
+
+    struct ss_tm_accel accel;
+    if(ss_tm_accel_init(&accel, tm, SS_TM_ACCEL_DEFAULT_MAX_RULE_RUNS) != SS_TM_ERR_NO_ERROR)
+        return false;
+    enum ss_tm_outcome outcome = SS_TM_OUTCOME_TIMEOUT;
+    bool ok = ss_tm_accel_begin(&accel, input, input_size) == SS_TM_ERR_NO_ERROR;
+    enum ss_tm_err accel_err = ss_tm_accel_run(&accel, max_macro_steps, &outcome);
+    uint64_t accel_steps;
+    bool steps_fit = ss_tm_bigint_to_u64(
+        &accel.tape.steps.constant, &accel_steps) == SS_TM_ERR_NO_ERROR;
+
+    totals->machines++;
+    totals->rules_proved += accel.rules_proved;
+    switch(outcome) {
+        case SS_TM_OUTCOME_ACCEPT:
+        case SS_TM_OUTCOME_REJECT:
+        case SS_TM_OUTCOME_ERROR:
+            if(outcome == SS_TM_OUTCOME_ERROR) {
+                totals->fell_off++;
+                ok = ok && accel_err == SS_TM_ERR_HEAD_FELL_OFF_TAPE && fell_off;
+            } else {
+                totals->halted++;
+                ok = ok && accel_err == SS_TM_ERR_NO_ERROR && halted &&
+                    (outcome == SS_TM_OUTCOME_ACCEPT) == (state == SS_TM_ACCEPT_STATE);
+            }
+            // Unless the simulator ran out of steps first.
+            if(!halted && !fell_off && (!steps_fit || accel_steps > steps))
+                break;
+            ok = ok && steps_fit && accel_steps == steps && check_tapes_match(&accel, tm);
+            break;
+        case SS_TM_OUTCOME_CLASSIFIED:
+            totals->classified++;
+            ok = ok && accel_err == SS_TM_ERR_NO_ERROR && !halted && !fell_off;
+            break;
+        default:
+            totals->timed_out++;
+            // It can't have gone past where the simulator stopped.
+            ok = ok && accel_err == SS_TM_ERR_NO_ERROR &&
+                (!(halted || fell_off) || (steps_fit && accel_steps < steps));
+            break;
+    }
+    if(!ok) {
+        totals->mismatches++;
+        printf("  simulator: %" PRIu64 " steps, %s; accelerator: outcome %d, error %d\n  ",
+            steps, fell_off ? "fell off" : halted ? "halted" : "running", outcome, accel_err);
+        ss_tm_accel_dump(&accel, stdout);
+    }
+    ss_tm_accel_destroy(&accel);
+    return ok;
+}
+
+static const char *check_beavers[] = {
+    "1RB1LB_1LA1RZ",
+    "1RB1RZ_1LB0RC_1LC1LA",
+    "1RB1LB_1LA0LC_1RZ1LD_1RD0RA",
+    "1RB1LC_1RC1RB_1RD0LE_1LA1LD_1RZ0LA"
+};
+
+int main(int argc, char *argv[]) {
+    unsigned num_random = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 1000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    uint64_t x = seed * 0x9E3779B97F4A7C15ull | 1;
+
+    uint64_t *padding = (uint64_t *)malloc(CHECK_PADDING_CELLS * sizeof(uint64_t));
+    if(!padding)
+        return 1;
+    size_t i;
+    for(i = 0; i < CHECK_PADDING_CELLS; i++)
+        padding[i] = CHECK_PADDING_CHAR;
+
+    struct check_totals totals;
+    memset(&totals, 0, sizeof(totals));
+    for(i = 0; i < sizeof(check_beavers) / sizeof(check_beavers[0]); i++) {
+        struct ss_tm tm;
+        ss_tm_init_begin(&tm);
+        check_add_compact_machine(&tm, check_beavers[i]);
+        ss_tm_init_end(&tm);
+        // Enough for bb5's 47176870 steps.
+        if(!check_machine(&tm, padding, CHECK_PADDING_CELLS, 100000000, 1000000, &totals))
+            printf("mismatch: %s\n", check_beavers[i]);
+        ss_tm_destroy(&tm);
+    }
+
+    unsigned n;
+    for(n = 0; n < num_random; n++) {
+        struct ss_tm tm;
+        ss_tm_init_begin(&tm);
+        check_add_random_machine(&tm, &x);
+        ss_tm_init_end(&tm);
+        size_t input_size = 1 + check_random(&x) % CHECK_MAX_RANDOM_PADDING;
+        if(!check_machine(&tm, padding, input_size, CHECK_MAX_STEPS, CHECK_MAX_MACRO_STEPS, &totals))
+            printf("mismatch: random machine %u of seed %" PRIu64 "\n", n, seed);
+        ss_tm_destroy(&tm);
+    }
+
+    printf("%u machines: %u halted, %u fell off, %u classified, %u timed out, "
+        "%" PRIu64 " rules proved, %u mismatches\n",
+        totals.machines, totals.halted, totals.fell_off, totals.classified,
+        totals.timed_out, totals.rules_proved, totals.mismatches);
+    free(padding);
+    return totals.mismatches ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+#include "ss_tm_batch.h"
+#include "ss_tm_monitor.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+struct ss_tm_batch_shared {
+    struct ss_tm *machine;
+    uint64_t max_steps;
+
+    // Array source. next_input is NULL when these are used.
+    const struct ss_tm_batch_input *inputs;
+    size_t num_inputs;
+    struct ss_tm_batch_result *out_results;
+
+    // Stream source.
+    ss_tm_batch_next_input_fn next_input;
+    ss_tm_batch_result_fn on_result;
+    void *user_data;
+
+    // NULL unless the batch is monitored. Worker i publishes to slot i.
+    struct ss_tm_monitor *monitor;
+
+    // Guards next_index, next_worker, and the stream's next_input.
+    pthread_mutex_t lock;
+    size_t next_index;
+    size_t next_worker;
+};
+
+    static void
+ss_tm_batch_simulate(
+    struct ss_tm_batch_shared *shared,
+    size_t worker_index,
+    struct ss_tm *worker,
+    enum ss_tm_err init_err,
+    size_t input_index,
+    const struct ss_tm_batch_input *input,
+    struct ss_tm_batch_result *out_result) {
+
+    uint64_t max_steps = shared->max_steps;
+
+    out_result->steps = 0;
+    if(init_err != SS_TM_ERR_NO_ERROR) {
+        out_result->outcome = SS_TM_OUTCOME_ERROR;
+        out_result->err = init_err;
+        return;
+    }
+    out_result->err = ss_tm_simulation_begin(
+        worker,
+        input->input_string,
+        input->input_string_size);
+    if(out_result->err == SS_TM_ERR_MEMORY_LIMIT_REACHED) {
+        out_result->outcome = SS_TM_OUTCOME_SPACE_LIMIT;
+        out_result->err = SS_TM_ERR_NO_ERROR;
+        return;
+    } else if(out_result->err != SS_TM_ERR_NO_ERROR) {
+        out_result->outcome = SS_TM_OUTCOME_ERROR;
+        return;
+    }
+
+    enum ss_tm_err e;
+    if(shared->monitor) {
+        e = ss_tm_monitor_step_multiple(
+            shared->monitor, worker_index, input_index, worker, max_steps);
+    } else {
+        e = ss_tm_simulation_step_multiple(worker, max_steps);
+    }
+    out_result->steps = worker->steps;
+    if(e == SS_TM_ERR_MEMORY_LIMIT_REACHED) {
+        out_result->outcome = SS_TM_OUTCOME_SPACE_LIMIT;
+        // Hand the memory back rather than holding it for the next input.
+        ss_tm_release_tape(worker);
+    } else if(e != SS_TM_ERR_NO_ERROR && e != SS_TM_ERR_STEP_ON_HALTED_MACHINE) {
+        out_result->outcome = SS_TM_OUTCOME_ERROR;
+        out_result->err = e;
+    } else if(worker->state == SS_TM_ACCEPT_STATE) {
+        out_result->outcome = SS_TM_OUTCOME_ACCEPT;
+    } else if(worker->state == SS_TM_REJECT_STATE) {
+        out_result->outcome = SS_TM_OUTCOME_REJECT;
+    } else {
+        out_result->outcome = SS_TM_OUTCOME_TIMEOUT;
+    }
+}
+
+    static void *
+ss_tm_batch_worker(
+    void *arg) {
+
+    struct ss_tm_batch_shared *shared = (struct ss_tm_batch_shared *)arg;
+    struct ss_tm worker;
+    // The machine was checked to be initialized before any worker started, 
+    // but the statistics, if compiled in, are allocated per worker. A worker 
+    // that couldn't allocate them still takes its share of the inputs, 
+    // failing each with the error.
+    enum ss_tm_err init_err = ss_tm_init_borrow(&worker, shared->machine);
+
+    pthread_mutex_lock(&shared->lock);
+    size_t worker_index = shared->next_worker++;
+    pthread_mutex_unlock(&shared->lock);
+
+    while(true) {
+        struct ss_tm_batch_input streamed;
+        const struct ss_tm_batch_input *input;
+        size_t input_index;
+
+        pthread_mutex_lock(&shared->lock);
+        input_index = shared->next_index;
+        if(shared->next_input) {
+            if(!shared->next_input(shared->user_data, &streamed)) {
+                pthread_mutex_unlock(&shared->lock);
+                break;
+            }
+            input = &streamed;
+        } else {
+            if(input_index == shared->num_inputs) {
+                pthread_mutex_unlock(&shared->lock);
+                break;
+            }
+            input = &shared->inputs[input_index];
+        }
+        shared->next_index++;
+        pthread_mutex_unlock(&shared->lock);
+
+        if(shared->next_input) {
+            struct ss_tm_batch_result result;
+            ss_tm_batch_simulate(
+                shared, worker_index, &worker, init_err, input_index, input, &result);
+            shared->on_result(shared->user_data, input_index, input, &result);
+        } else {
+            ss_tm_batch_simulate(
+                shared,
+                worker_index,
+                &worker,
+                init_err,
+                input_index,
+                input,
+                &shared->out_results[input_index]);
+        }
+    }
+
+    if(shared->monitor)
+        ss_tm_monitor_clear(shared->monitor, worker_index);
+
+    ss_tm_destroy(&worker);
+    return NULL;
+}
+
+    static enum ss_tm_err
+ss_tm_batch_run_shared(
+    struct ss_tm_batch_shared *shared,
+    size_t num_threads) {
+
+    if(!shared->machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+
+    if(num_threads == 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = num_cpus > 0 ? (size_t)num_cpus : 1;
+    }
+    if(!shared->next_input && num_threads > shared->num_inputs)
+        num_threads = shared->num_inputs;
+    if(shared->monitor && num_threads > shared->monitor->num_slots)
+        num_threads = shared->monitor->num_slots;
+    if(num_threads == 0)
+        return SS_TM_ERR_NO_ERROR;
+
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    if(!threads)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    pthread_mutex_init(&shared->lock, NULL);
+    shared->next_index = 0;
+    shared->next_worker = 0;
+
+    enum ss_tm_err result = SS_TM_ERR_NO_ERROR;
+    size_t num_started;
+    for(num_started = 0; num_started < num_threads; num_started++) {
+        if(pthread_create(&threads[num_started], NULL, ss_tm_batch_worker, shared)) {
+            result = SS_TM_ERR_THREAD_CREATE_FAILED;
+            break;
+        }
+    }
+    // Workers that did start still drain the whole batch, so a partial
+    // failure only costs parallelism.
+    if(num_started > 0)
+        result = SS_TM_ERR_NO_ERROR;
+
+    size_t i;
+    for(i = 0; i < num_started; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&shared->lock);
+    free(threads);
+    return result;
+}
+
+    enum ss_tm_err
+ss_tm_batch_run(
+    struct ss_tm *machine,
+    const struct ss_tm_batch_input *inputs,
+    size_t num_inputs,
+    uint64_t max_steps,
+    size_t num_threads,
+    struct ss_tm_batch_result *out_results) {
+
+    struct ss_tm_batch_shared shared;
+    shared.machine = machine;
+    shared.max_steps = max_steps;
+    shared.inputs = inputs;
+    shared.num_inputs = num_inputs;
+    shared.out_results = out_results;
+    shared.next_input = NULL;
+    shared.on_result = NULL;
+    shared.user_data = NULL;
+    shared.monitor = NULL;
+    return ss_tm_batch_run_shared(&shared, num_threads);
+}
+
+    enum ss_tm_err
+ss_tm_batch_run_stream(
+    struct ss_tm *machine,
+    ss_tm_batch_next_input_fn next_input,
+    ss_tm_batch_result_fn on_result,
+    void *user_data,
+    uint64_t max_steps,
+    size_t num_threads) {
+
+    struct ss_tm_batch_shared shared;
+    shared.machine = machine;
+    shared.max_steps = max_steps;
+    shared.inputs = NULL;
+    shared.num_inputs = 0;
+    shared.out_results = NULL;
+    shared.next_input = next_input;
+    shared.on_result = on_result;
+    shared.user_data = user_data;
+    shared.monitor = NULL;
+    return ss_tm_batch_run_shared(&shared, num_threads);
+}
+
+    enum ss_tm_err
+ss_tm_batch_run_monitored(
+    struct ss_tm *machine,
+    const struct ss_tm_batch_input *inputs,
+    size_t num_inputs,
+    uint64_t max_steps,
+    size_t num_threads,
+    struct ss_tm_monitor *monitor,
+    struct ss_tm_batch_result *out_results) {
+
+    struct ss_tm_batch_shared shared;
+    shared.machine = machine;
+    shared.max_steps = max_steps;
+    shared.inputs = inputs;
+    shared.num_inputs = num_inputs;
+    shared.out_results = out_results;
+    shared.next_input = NULL;
+    shared.on_result = NULL;
+    shared.user_data = NULL;
+    shared.monitor = monitor;
+    return ss_tm_batch_run_shared(&shared, num_threads);
+}
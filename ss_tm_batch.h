@@ -0,0 +1,86 @@
+#ifndef ss_tm_batch_h
+#define ss_tm_batch_h
+
+#include "ss_tm.h"
+
+// Runs one initialized machine over many input strings in parallel. Every
+// worker thread borrows the machine's transition table (see
+// ss_tm_init_borrow), so the table is shared read-only and only tapes are
+// allocated per input.
+
+struct ss_tm_batch_input {
+    uint64_t *input_string;
+    size_t input_string_size;
+};
+
+struct ss_tm_batch_result {
+    enum ss_tm_outcome outcome;
+    // SS_TM_ERR_NO_ERROR unless outcome is SS_TM_OUTCOME_ERROR.
+    enum ss_tm_err err;
+    uint64_t steps;
+};
+
+// Pulls the next input of a stream. Returns false once the stream is
+// exhausted. Calls are serialized by the batch, so this needn't be
+// thread-safe. The input must stay valid until its result has been delivered.
+typedef bool (*ss_tm_batch_next_input_fn)(
+    void *user_data,
+    struct ss_tm_batch_input *out_input);
+
+// Receives the result for the input_index'th input pulled from a stream.
+// Called from the worker threads, possibly concurrently, and in no particular
+// order.
+typedef void (*ss_tm_batch_result_fn)(
+    void *user_data,
+    size_t input_index,
+    const struct ss_tm_batch_input *input,
+    const struct ss_tm_batch_result *result);
+
+// Simulates machine on each of inputs for at most max_steps steps, writing
+// the result for inputs[i] to out_results[i]. num_threads of 0 uses one
+// thread per online CPU. machine must be initialized and mustn't be modified
+// or simulated while the batch runs.
+//
+// A bad input is reported in its result rather than failing the batch; the
+// return value only reports failures of the batch itself.
+//
+// Workers take on machine's space limits (see ss_tm_set_space_limits), so 
+// giving machine a budget bounds the tapes of the whole batch. An input whose
+// tape would outgrow them gets SS_TM_OUTCOME_SPACE_LIMIT, and its tape is 
+// freed for the other workers.
+    enum ss_tm_err
+ss_tm_batch_run(
+    struct ss_tm *machine,
+    const struct ss_tm_batch_input *inputs,
+    size_t num_inputs,
+    uint64_t max_steps,
+    size_t num_threads,
+    struct ss_tm_batch_result *out_results);
+
+// Like ss_tm_batch_run, but for inputs whose number isn't known up front.
+    enum ss_tm_err
+ss_tm_batch_run_stream(
+    struct ss_tm *machine,
+    ss_tm_batch_next_input_fn next_input,
+    ss_tm_batch_result_fn on_result,
+    void *user_data,
+    uint64_t max_steps,
+    size_t num_threads);
+
+struct ss_tm_monitor;
+
+// Like ss_tm_batch_run, but each worker publishes its progress to monitor
+// (see ss_tm_monitor.h) as it goes: worker i to slot i, with the index of the
+// input it's simulating as the id. At most monitor->num_slots workers are 
+// started, whatever num_threads asks for.
+    enum ss_tm_err
+ss_tm_batch_run_monitored(
+    struct ss_tm *machine,
+    const struct ss_tm_batch_input *inputs,
+    size_t num_inputs,
+    uint64_t max_steps,
+    size_t num_threads,
+    struct ss_tm_monitor *monitor,
+    struct ss_tm_batch_result *out_results);
+
+#endif // #ifndef ss_tm_batch_h
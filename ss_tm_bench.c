@@ -0,0 +1,601 @@
+// Benchmarks the simulator on a fixed corpus of machines and prints one JSON
+// object per (machine, engine) pair, so results can be compared between
+// releases. Build with optimizations, e.g.
+//   cc -std=gnu11 -O2 ss_tm_bench.c ss_tm.c ss_tm_accel.c ss_tm_bigint.c ss_tm_soon.c
+//       -o ss_tm_bench
+// and run with no arguments, or with the names of the machines to run. Each
+// pair runs in a child process of its own, so peak_rss_kib is that run's
+// alone (plus the few pages the bench itself had when it forked).
+//
+// The accel engine's step counts can be far past 2^64, so it reports steps
+// as a decimal string, and macro_steps, rules_proved and rule_applications
+// besides; it has no tape_cells or tape_reallocs, which are null.
+
+#include "ss_tm.h"
+#include "ss_tm_accel.h"
+#include "ss_tm_soon.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Two-way-tape machines (the busy beavers) are run on the one-way tape by
+// starting them at the end of a run of padding cells. The padding symbol
+// behaves exactly like a blank, and a preamble state walks over it first, so
+// their step counts include BENCH_PADDING_CELLS preamble steps.
+#define BENCH_PADDING_CHAR 2ull
+#define BENCH_PADDING_CELLS (1ull << 16)
+#define BENCH_PREAMBLE_STATE SS_TM_INITIAL_STATE
+// State letter A maps to this state, B to the one after, and so on.
+#define BENCH_FIRST_LETTER_STATE 1ull
+
+struct bench_machine {
+    const char *name;
+    // Builds the machine between ss_tm_init_begin and ss_tm_init_end.
+    void (*add_transitions)(struct ss_tm *tm);
+    // Fills in the input. Returns its size.
+    size_t (*make_input)(uint64_t **out_input);
+    // Steps to run if the machine doesn't halt first.
+    uint64_t max_steps;
+    // The same for the accel engine, in macro steps.
+    uint64_t max_macro_steps;
+};
+
+enum bench_engine {
+    // ss_tm_simulation_step in a loop.
+    BENCH_ENGINE_STEP,
+    BENCH_ENGINE_STEP_MULTIPLE,
+    // ss_tm_accel_run, with the default rule run cap.
+    BENCH_ENGINE_ACCEL
+};
+
+const char *bench_engine_names[] = {
+    "step",
+    "step_multiple",
+    "accel"
+};
+
+    double
+bench_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Adds a transition for the compact notation triple at s (e.g. "1RB"), taken
+// in state in_state on in_char. Also adds it for the padding symbol when
+// in_char is blank.
+    void
+bench_add_compact_transition(
+    struct ss_tm *tm,
+    uint64_t in_state,
+    uint64_t in_char,
+    const char *s) {
+
+    if(s[0] == '-')
+        return;
+    struct ss_tm_transition trans;
+    trans.in_state = in_state;
+    trans.in_char = in_char;
+    trans.out_char = s[0] - '0';
+    trans.out_right = s[1] == 'R';
+    trans.out_state = s[2] == 'Z' || s[2] == 'H' ?
+        SS_TM_ACCEPT_STATE : BENCH_FIRST_LETTER_STATE + (s[2] - 'A');
+    ss_tm_add_state_transition(tm, trans);
+    if(in_char == 0) {
+        trans.in_char = BENCH_PADDING_CHAR;
+        ss_tm_add_state_transition(tm, trans);
+    }
+}
+
+// Adds a two-symbol machine in the usual compact notation, e.g.
+// "1RB1LB_1LA1RZ", where Z is the halt state, along with the preamble that
+// walks to the end of the padding and starts it in state A there.
+    void
+bench_add_compact_machine(
+    struct ss_tm *tm,
+    const char *compact) {
+
+    struct ss_tm_transition trans;
+    trans.in_state = BENCH_PREAMBLE_STATE;
+    trans.in_char = BENCH_PADDING_CHAR;
+    trans.out_state = BENCH_PREAMBLE_STATE;
+    trans.out_char = BENCH_PADDING_CHAR;
+    trans.out_right = true;
+    ss_tm_add_state_transition(tm, trans);
+
+    uint64_t state = BENCH_FIRST_LETTER_STATE;
+    const char *p = compact;
+    while(*p) {
+        // The preamble acts as state A on the first real blank.
+        if(state == BENCH_FIRST_LETTER_STATE) {
+            struct ss_tm_transition start;
+            start.in_state = BENCH_PREAMBLE_STATE;
+            start.in_char = 0;
+            start.out_char = p[0] - '0';
+            start.out_right = p[1] == 'R';
+            start.out_state = p[2] == 'Z' || p[2] == 'H' ?
+                SS_TM_ACCEPT_STATE : BENCH_FIRST_LETTER_STATE + (p[2] - 'A');
+            ss_tm_add_state_transition(tm, start);
+        }
+        bench_add_compact_transition(tm, state, 0, p);
+        bench_add_compact_transition(tm, state, 1, p + 3);
+        p += 6;
+        if(*p == '_')
+            p++;
+        state++;
+    }
+}
+
+    size_t
+bench_padding_input(
+    uint64_t **out_input) {
+
+    uint64_t *input = malloc(BENCH_PADDING_CELLS * sizeof(uint64_t));
+    size_t i;
+    for(i = 0; i < BENCH_PADDING_CELLS; i++)
+        input[i] = BENCH_PADDING_CHAR;
+    *out_input = input;
+    return BENCH_PADDING_CELLS;
+}
+
+    size_t
+bench_empty_input(
+    uint64_t **out_input) {
+
+    *out_input = NULL;
+    return 0;
+}
+
+    void
+bench_add_bb2(
+    struct ss_tm *tm) {
+
+    bench_add_compact_machine(tm, "1RB1LB_1LA1RZ");
+}
+
+    void
+bench_add_bb3(
+    struct ss_tm *tm) {
+
+    bench_add_compact_machine(tm, "1RB1RZ_1LB0RC_1LC1LA");
+}
+
+    void
+bench_add_bb4(
+    struct ss_tm *tm) {
+
+    bench_add_compact_machine(tm, "1RB1LB_1LA0LC_1RZ1LD_1RD0RA");
+}
+
+    void
+bench_add_bb5(
+    struct ss_tm *tm) {
+
+    bench_add_compact_machine(tm, "1RB1LC_1RC1RB_1RD0LE_1LA1LD_1RZ0LA");
+}
+
+// The SOON-TM emulation example.c runs its candidates on, simulating the
+// machine of its verifier.
+#define BENCH_SOON_START_STATE (SS_TM_INITIAL_STATE + 1000)
+
+    void
+bench_add_soon(
+    struct ss_tm *tm) {
+
+    ss_tm_soon_add_emulation(tm, BENCH_SOON_START_STATE);
+    ss_tm_soon_add_verified_machine(tm, BENCH_SOON_START_STATE);
+}
+
+    size_t
+bench_soon_input(
+    uint64_t **out_input) {
+
+    uint64_t *input = malloc(2 * sizeof(uint64_t));
+    input[0] = ss_tm_soon_symbol('[');
+    input[1] = ss_tm_soon_symbol(']');
+    *out_input = input;
+    return 2;
+}
+
+// Writes 1s rightwards forever, growing the tape every time it fills.
+    void
+bench_add_right_sweep(
+    struct ss_tm *tm) {
+
+    struct ss_tm_transition trans = {SS_TM_INITIAL_STATE, 0, SS_TM_INITIAL_STATE, 1, true};
+    ss_tm_add_state_transition(tm, trans);
+}
+
+// A binary counter whose low bit is at the right. After every increment the
+// head returns to the '[' (2) at cell 0, so it spends its time against the
+// left edge. Digits are 1 (one) and 3 (zero).
+    void
+bench_add_left_edge_counter(
+    struct ss_tm *tm) {
+
+    static const struct ss_tm_transition transitions[] = {
+        // Walk right to the end of the digits.
+        {0, 2, 0, 2, true},
+        {0, 1, 0, 1, true},
+        {0, 3, 0, 3, true},
+        {0, 0, 1, 0, false},
+        // Add one, carrying leftwards.
+        {1, 1, 1, 3, false},
+        {1, 3, 2, 1, false},
+        {1, 2, 0, 2, true},
+        // Return to the left edge.
+        {2, 1, 2, 1, false},
+        {2, 3, 2, 3, false},
+        {2, 2, 0, 2, true}
+    };
+    size_t i;
+    for(i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++)
+        ss_tm_add_state_transition(tm, transitions[i]);
+}
+
+    size_t
+bench_left_edge_counter_input(
+    uint64_t **out_input) {
+
+    uint64_t *input = malloc(24 * sizeof(uint64_t));
+    input[0] = 2;
+    size_t i;
+    for(i = 1; i < 24; i++)
+        input[i] = 3;
+    *out_input = input;
+    return 24;
+}
+
+// Doubles a unary count over and over, forever. Symbols are 1 (one), 2 ('[',
+// at cell 0), 3 (a one already doubled) and 4 (a new one). Each pass moves
+// one mark from the ones to the end of the new ones, a linear loop that the
+// accel engine proves a rule for and then crosses a whole doubling at a time.
+    void
+bench_add_unary_doubler(
+    struct ss_tm *tm) {
+
+    enum {
+        start = 0,
+        // Find the next one to double.
+        find = 10,
+        // Carry it to the end of the new ones as two 4s.
+        carry,
+        carry_second,
+        // Back to the doubled ones.
+        back,
+        // Turn the new ones into ones, and go back to cell 0.
+        convert,
+        rewind
+    };
+    static const struct ss_tm_transition transitions[] = {
+        {start, 2, find, 2, true},
+        {find, 3, find, 3, true},
+        {find, 1, carry, 3, true},
+        {find, 4, convert, 1, true},
+        {carry, 1, carry, 1, true},
+        {carry, 4, carry, 4, true},
+        {carry, 0, carry_second, 4, true},
+        {carry_second, 0, back, 4, false},
+        {back, 4, back, 4, false},
+        {back, 1, back, 1, false},
+        {back, 3, find, 3, true},
+        {convert, 4, convert, 1, true},
+        {convert, 0, rewind, 0, false},
+        {rewind, 1, rewind, 1, false},
+        {rewind, 3, rewind, 3, false},
+        {rewind, 2, find, 2, true}
+    };
+    size_t i;
+    for(i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++)
+        ss_tm_add_state_transition(tm, transitions[i]);
+}
+
+    size_t
+bench_unary_doubler_input(
+    uint64_t **out_input) {
+
+    uint64_t *input = malloc(2 * sizeof(uint64_t));
+    input[0] = 2;
+    input[1] = 1;
+    *out_input = input;
+    return 2;
+}
+
+// 2^14 states with scattered numbers and pseudo-random transitions on blank,
+// padding and 1, so nearly every step looks up a different key. They're
+// reached through a preamble that walks to the 1 in the middle of the
+// padding.
+#define BENCH_SPARSE_STATES (1u << 14)
+
+    uint64_t
+bench_sparse_state(
+    uint32_t i) {
+
+    // Spread over the whole range, clear of the initial, accept and reject
+    // states.
+    return ((uint64_t)(i + 1) * 0x9E3779B97F4A7C15ull) >> 2;
+}
+
+    void
+bench_add_sparse(
+    struct ss_tm *tm) {
+
+    struct ss_tm_transition preamble[2] = {
+        {BENCH_PREAMBLE_STATE, BENCH_PADDING_CHAR, BENCH_PREAMBLE_STATE, BENCH_PADDING_CHAR, true},
+        {BENCH_PREAMBLE_STATE, 1, bench_sparse_state(0), BENCH_PADDING_CHAR, true}
+    };
+    ss_tm_add_state_transition(tm, preamble[0]);
+    ss_tm_add_state_transition(tm, preamble[1]);
+
+    // xorshift, so the table is the same on every run.
+    uint64_t x = 0x2545F4914F6CDD1Dull;
+    uint32_t i;
+    for(i = 0; i < BENCH_SPARSE_STATES; i++) {
+        uint64_t in_chars[3] = {0, 1, BENCH_PADDING_CHAR};
+        int c;
+        for(c = 0; c < 3; c++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            struct ss_tm_transition trans;
+            trans.in_state = bench_sparse_state(i);
+            trans.in_char = in_chars[c];
+            trans.out_state = bench_sparse_state((uint32_t)(x >> 40) % BENCH_SPARSE_STATES);
+            trans.out_char = (x >> 8) & 1;
+            trans.out_right = (x >> 9) & 1;
+            ss_tm_add_state_transition(tm, trans);
+        }
+    }
+}
+
+    size_t
+bench_sparse_input(
+    uint64_t **out_input) {
+
+    // Mark where the random walk starts.
+    uint64_t *input;
+    size_t input_size = bench_padding_input(&input);
+    input[input_size / 2] = 1;
+    *out_input = input;
+    return input_size;
+}
+
+static const struct bench_machine bench_machines[] = {
+    {"bb2", bench_add_bb2, bench_padding_input, 1000000, 1000000},
+    {"bb3", bench_add_bb3, bench_padding_input, 1000000, 1000000},
+    {"bb4", bench_add_bb4, bench_padding_input, 1000000, 1000000},
+    {"bb5", bench_add_bb5, bench_padding_input, 100000000, 1000000},
+    {"soon_verifier", bench_add_soon, bench_soon_input, 20000000, 1000000},
+    {"right_sweep", bench_add_right_sweep, bench_empty_input, 4000000, 1000000},
+    {"left_edge_counter", bench_add_left_edge_counter, bench_left_edge_counter_input, 50000000, 200000},
+    {"sparse_table", bench_add_sparse, bench_sparse_input, 20000000, 1000000},
+    {"unary_doubler", bench_add_unary_doubler, bench_unary_doubler_input, 100000000, 10000}
+};
+
+// bench_run for the accel engine, on tm built in construct_seconds.
+    void
+bench_run_accel(
+    const struct bench_machine *machine,
+    const struct ss_tm *tm,
+    double construct_seconds,
+    const uint64_t *input,
+    size_t input_size,
+    FILE *out) {
+
+    struct ss_tm_accel accel;
+    enum ss_tm_err e = ss_tm_accel_init(&accel, tm, SS_TM_ACCEL_DEFAULT_MAX_RULE_RUNS);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        fprintf(stderr, "%s: ss_tm_accel_init failed: %d\n", machine->name, e);
+        exit(1);
+    }
+    enum ss_tm_outcome accel_outcome = SS_TM_OUTCOME_ERROR;
+    double run_begin = bench_now();
+    e = ss_tm_accel_begin(&accel, input, input_size);
+    if(e == SS_TM_ERR_NO_ERROR)
+        e = ss_tm_accel_run(&accel, machine->max_macro_steps, &accel_outcome);
+    double run_seconds = bench_now() - run_begin;
+
+    char *steps;
+    if(ss_tm_bigint_to_str(&accel.tape.steps.constant, &steps) != SS_TM_ERR_NO_ERROR) {
+        fprintf(stderr, "%s: out of memory\n", machine->name);
+        exit(1);
+    }
+
+    const char *outcome;
+    switch(e == SS_TM_ERR_NO_ERROR ? accel_outcome : SS_TM_OUTCOME_ERROR) {
+        case SS_TM_OUTCOME_ACCEPT:
+            outcome = "accept";
+            break;
+        case SS_TM_OUTCOME_REJECT:
+            outcome = "reject";
+            break;
+        case SS_TM_OUTCOME_TIMEOUT:
+            outcome = "timeout";
+            break;
+        case SS_TM_OUTCOME_CLASSIFIED:
+            outcome = "classified";
+            break;
+        default:
+            outcome = "error";
+            break;
+    }
+
+    fprintf(out, "\"machine\": \"%s\", \"engine\": \"%s\", \"transitions\": %zu, "
+        "\"construct_seconds\": %.6f, \"steps\": \"%s\", \"run_seconds\": %.6f, "
+        "\"steps_per_second\": %.6g, \"outcome\": \"%s\", \"tape_cells\": null, "
+        "\"tape_reallocs\": null, \"macro_steps\": %" PRIu64 ", \"rules_proved\": %" PRIu64 ", "
+        "\"rule_applications\": %" PRIu64,
+        machine->name,
+        bench_engine_names[BENCH_ENGINE_ACCEL],
+        tm->transitions_end,
+        construct_seconds,
+        steps,
+        run_seconds,
+        run_seconds > 0 ? strtod(steps, NULL) / run_seconds : 0.0,
+        outcome,
+        accel.macro_steps,
+        accel.rules_proved,
+        accel.rule_applications);
+
+    free(steps);
+    ss_tm_accel_destroy(&accel);
+}
+
+// Runs machine on engine and writes the results to out as the fields of a
+// JSON object, less the braces and peak_rss_kib.
+    void
+bench_run(
+    const struct bench_machine *machine,
+    enum bench_engine engine,
+    FILE *out) {
+
+    double construct_begin = bench_now();
+    struct ss_tm tm;
+    ss_tm_init_begin(&tm);
+    machine->add_transitions(&tm);
+    ss_tm_init_end(&tm);
+    double construct_seconds = bench_now() - construct_begin;
+
+    uint64_t *input;
+    size_t input_size = machine->make_input(&input);
+    if(engine == BENCH_ENGINE_ACCEL) {
+        bench_run_accel(machine, &tm, construct_seconds, input, input_size, out);
+        free(input);
+        ss_tm_destroy(&tm);
+        return;
+    }
+    enum ss_tm_err e = ss_tm_simulation_begin(&tm, input, input_size);
+    free(input);
+    if(e != SS_TM_ERR_NO_ERROR)
+        fprintf(stderr, "%s: ss_tm_simulation_begin failed: %s\n", machine->name, ss_tm_err_str[e]);
+
+    double run_begin = bench_now();
+    // Neither engine runs after a failed begin; the outcome is then "error".
+    switch(engine) {
+        case BENCH_ENGINE_STEP: {
+            uint64_t i;
+            for(i = 0; i < machine->max_steps && e == SS_TM_ERR_NO_ERROR; i++)
+                e = ss_tm_simulation_step(&tm);
+            break;
+        }
+        case BENCH_ENGINE_STEP_MULTIPLE:
+        default:
+            if(e == SS_TM_ERR_NO_ERROR)
+                e = ss_tm_simulation_step_multiple(&tm, machine->max_steps);
+            break;
+    }
+    double run_seconds = bench_now() - run_begin;
+
+    const char *outcome;
+    if(e != SS_TM_ERR_NO_ERROR && e != SS_TM_ERR_STEP_ON_HALTED_MACHINE)
+        outcome = "error";
+    else if(tm.state == SS_TM_ACCEPT_STATE)
+        outcome = "accept";
+    else if(tm.state == SS_TM_REJECT_STATE)
+        outcome = "reject";
+    else
+        outcome = "timeout";
+
+    fprintf(out, "\"machine\": \"%s\", \"engine\": \"%s\", \"transitions\": %zu, "
+        "\"construct_seconds\": %.6f, \"steps\": %" PRIu64 ", \"run_seconds\": %.6f, "
+        "\"steps_per_second\": %.0f, \"outcome\": \"%s\", \"tape_cells\": %zu, "
+        "\"tape_reallocs\": %" PRIu64,
+        machine->name,
+        bench_engine_names[engine],
+        tm.transitions_end,
+        construct_seconds,
+        tm.steps,
+        run_seconds,
+        run_seconds > 0 ? tm.steps / run_seconds : 0.0,
+        outcome,
+        tm.tape_size,
+        tm.tape_reallocs);
+
+    ss_tm_destroy(&tm);
+}
+
+// Runs bench_run in a child process and prints its results as a JSON object
+// along with the child's peak resident set size. A child that dies is
+// reported with outcome "crashed".
+    void
+bench_run_isolated(
+    const struct bench_machine *machine,
+    enum bench_engine engine) {
+
+    int fds[2];
+    if(pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0) {
+        close(fds[0]);
+        FILE *out = fdopen(fds[1], "w");
+        if(!out)
+            _exit(1);
+        bench_run(machine, engine, out);
+        _exit(fclose(out) == 0 ? 0 : 1);
+    }
+
+    close(fds[1]);
+    // Room for an accel step count of a few thousand digits.
+    char fields[8192];
+    size_t fields_size = 0;
+    ssize_t n;
+    while((n = read(fds[0], fields + fields_size, sizeof(fields) - 1 - fields_size)) > 0)
+        fields_size += n;
+    close(fds[0]);
+    fields[fields_size] = '\0';
+
+    int status;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    while(wait4(pid, &status, 0, &usage) < 0) {
+        if(errno != EINTR) {
+            perror("wait4");
+            exit(1);
+        }
+    }
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0 || fields_size == 0) {
+        printf("{\"machine\": \"%s\", \"engine\": \"%s\", \"outcome\": \"crashed\", "
+            "\"peak_rss_kib\": %ld}\n",
+            machine->name,
+            bench_engine_names[engine],
+            usage.ru_maxrss);
+    } else {
+        printf("{%s, \"peak_rss_kib\": %ld}\n", fields, usage.ru_maxrss);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t num_machines = sizeof(bench_machines) / sizeof(bench_machines[0]);
+    size_t i;
+    for(i = 0; i < num_machines; i++) {
+        if(argc > 1) {
+            int a;
+            for(a = 1; a < argc; a++) {
+                if(strcmp(argv[a], bench_machines[i].name) == 0)
+                    break;
+            }
+            if(a == argc)
+                continue;
+        }
+        int engine;
+        for(engine = BENCH_ENGINE_STEP; engine <= BENCH_ENGINE_ACCEL; engine++)
+            bench_run_isolated(&bench_machines[i], (enum bench_engine)engine);
+    }
+    return 0;
+}
@@ -0,0 +1,450 @@
+#include "ss_tm_bigint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+    static enum ss_tm_err
+ss_tm_bigint_reserve(
+    struct ss_tm_bigint *self,
+    size_t capacity) {
+
+    if(capacity <= self->capacity)
+        return SS_TM_ERR_NO_ERROR;
+    size_t new_capacity = self->capacity * 2;
+    if(new_capacity < capacity)
+        new_capacity = capacity;
+    if(new_capacity < 4)
+        new_capacity = 4;
+    uint32_t *limbs = (uint32_t *)realloc(self->limbs, new_capacity * sizeof(uint32_t));
+    if(!limbs)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    self->limbs = limbs;
+    self->capacity = new_capacity;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static void
+ss_tm_bigint_normalize(
+    struct ss_tm_bigint *self) {
+
+    while(self->size > 0 && self->limbs[self->size - 1] == 0)
+        self->size--;
+    if(self->size == 0)
+        self->negative = false;
+}
+
+// Points self at limbs, which must hold at least 2 limbs, and sets it to
+// value. Such a bigint needs no destroy, and mustn't be written to.
+    static void
+ss_tm_bigint_wrap_i64(
+    struct ss_tm_bigint *self,
+    uint32_t *limbs,
+    int64_t value) {
+
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    limbs[0] = (uint32_t)magnitude;
+    limbs[1] = (uint32_t)(magnitude >> 32);
+    self->limbs = limbs;
+    self->size = 2;
+    self->capacity = 2;
+    self->negative = value < 0;
+    ss_tm_bigint_normalize(self);
+}
+
+    static int
+ss_tm_bigint_cmp_magnitude(
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    if(a->size != b->size)
+        return a->size < b->size ? -1 : 1;
+    size_t i = a->size;
+    while(i > 0) {
+        i--;
+        if(a->limbs[i] != b->limbs[i])
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_init(
+    struct ss_tm_bigint *self) {
+
+    self->limbs = NULL;
+    self->size = 0;
+    self->capacity = 0;
+    self->negative = false;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_destroy(
+    struct ss_tm_bigint *self) {
+
+    free(self->limbs);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_set_i64(
+    struct ss_tm_bigint *self,
+    int64_t value) {
+
+    uint32_t limbs[2];
+    struct ss_tm_bigint wrapped;
+    ss_tm_bigint_wrap_i64(&wrapped, limbs, value);
+    return ss_tm_bigint_copy(self, &wrapped);
+}
+
+    enum ss_tm_err
+ss_tm_bigint_set_u64(
+    struct ss_tm_bigint *self,
+    uint64_t value) {
+
+    enum ss_tm_err e = ss_tm_bigint_reserve(self, 2);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    self->limbs[0] = (uint32_t)value;
+    self->limbs[1] = (uint32_t)(value >> 32);
+    self->size = 2;
+    self->negative = false;
+    ss_tm_bigint_normalize(self);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_copy(
+    struct ss_tm_bigint *self,
+    const struct ss_tm_bigint *value) {
+
+    if(self == value)
+        return SS_TM_ERR_NO_ERROR;
+    enum ss_tm_err e = ss_tm_bigint_reserve(self, value->size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    if(value->size)
+        memcpy(self->limbs, value->limbs, value->size * sizeof(uint32_t));
+    self->size = value->size;
+    self->negative = value->negative;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// result = a + b, or a - b if negate_b. Works limb by limb in place, so
+// result may be a or b.
+    static enum ss_tm_err
+ss_tm_bigint_add_signed(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b,
+    bool negate_b) {
+
+    bool a_negative = a->negative;
+    bool b_negative = b->negative != negate_b && b->size > 0;
+    size_t a_size = a->size;
+    size_t b_size = b->size;
+    size_t size = a_size > b_size ? a_size : b_size;
+
+    if(a_negative == b_negative) {
+        enum ss_tm_err e = ss_tm_bigint_reserve(result, size + 1);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+        // Reserving may have moved a's or b's limbs, if either is result.
+        const uint32_t *x = a->limbs;
+        const uint32_t *y = b->limbs;
+        uint64_t carry = 0;
+        size_t i;
+        for(i = 0; i < size; i++) {
+            uint64_t sum = carry;
+            if(i < a_size)
+                sum += x[i];
+            if(i < b_size)
+                sum += y[i];
+            result->limbs[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+        result->limbs[size] = (uint32_t)carry;
+        result->size = size + 1;
+        result->negative = a_negative;
+        ss_tm_bigint_normalize(result);
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    // Opposite signs: subtract the smaller magnitude from the larger, and
+    // take the larger's sign.
+    const struct ss_tm_bigint *larger = a;
+    const struct ss_tm_bigint *smaller = b;
+    bool negative = a_negative;
+    if(ss_tm_bigint_cmp_magnitude(a, b) < 0) {
+        larger = b;
+        smaller = a;
+        negative = b_negative;
+    }
+    size_t larger_size = larger->size;
+    size_t smaller_size = smaller->size;
+    enum ss_tm_err e = ss_tm_bigint_reserve(result, larger_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    const uint32_t *x = larger->limbs;
+    const uint32_t *y = smaller->limbs;
+    int64_t borrow = 0;
+    size_t i;
+    for(i = 0; i < larger_size; i++) {
+        int64_t difference = (int64_t)x[i] - borrow - (i < smaller_size ? (int64_t)y[i] : 0);
+        borrow = difference < 0;
+        result->limbs[i] = (uint32_t)(difference + (borrow << 32));
+    }
+    result->size = larger_size;
+    result->negative = negative;
+    ss_tm_bigint_normalize(result);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_add(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    return ss_tm_bigint_add_signed(result, a, b, false);
+}
+
+    enum ss_tm_err
+ss_tm_bigint_sub(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    return ss_tm_bigint_add_signed(result, a, b, true);
+}
+
+    enum ss_tm_err
+ss_tm_bigint_mul(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    if(a->size == 0 || b->size == 0)
+        return ss_tm_bigint_set_u64(result, 0);
+
+    // Schoolbook, into a fresh product so that result may alias either
+    // operand.
+    struct ss_tm_bigint product;
+    ss_tm_bigint_init(&product);
+    enum ss_tm_err e = ss_tm_bigint_reserve(&product, a->size + b->size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    memset(product.limbs, 0, (a->size + b->size) * sizeof(uint32_t));
+    size_t i;
+    for(i = 0; i < a->size; i++) {
+        uint64_t carry = 0;
+        size_t j;
+        for(j = 0; j < b->size; j++) {
+            uint64_t t = (uint64_t)a->limbs[i] * b->limbs[j] + product.limbs[i + j] + carry;
+            product.limbs[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product.limbs[i + b->size] = (uint32_t)carry;
+    }
+    product.size = a->size + b->size;
+    product.negative = a->negative != b->negative;
+    ss_tm_bigint_normalize(&product);
+
+    ss_tm_bigint_destroy(result);
+    *result = product;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_add_i64(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    int64_t b) {
+
+    uint32_t limbs[2];
+    struct ss_tm_bigint wrapped;
+    ss_tm_bigint_wrap_i64(&wrapped, limbs, b);
+    return ss_tm_bigint_add(result, a, &wrapped);
+}
+
+    enum ss_tm_err
+ss_tm_bigint_mul_i64(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    int64_t b) {
+
+    uint32_t limbs[2];
+    struct ss_tm_bigint wrapped;
+    ss_tm_bigint_wrap_i64(&wrapped, limbs, b);
+    return ss_tm_bigint_mul(result, a, &wrapped);
+}
+
+// Divides the magnitude in limbs[0..size) by divisor in place, returning the
+// remainder.
+    static uint32_t
+ss_tm_bigint_div_limb(
+    uint32_t *limbs,
+    size_t size,
+    uint32_t divisor) {
+
+    uint64_t remainder = 0;
+    size_t i = size;
+    while(i > 0) {
+        i--;
+        uint64_t t = (remainder << 32) | limbs[i];
+        limbs[i] = (uint32_t)(t / divisor);
+        remainder = t % divisor;
+    }
+    return (uint32_t)remainder;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_div(
+    struct ss_tm_bigint *quotient,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    if(b->size == 0)
+        return SS_TM_ERR_OUT_OF_RANGE;
+    bool negative = a->negative != b->negative;
+    if(ss_tm_bigint_cmp_magnitude(a, b) < 0)
+        return ss_tm_bigint_set_u64(quotient, 0);
+
+    struct ss_tm_bigint q;
+    ss_tm_bigint_init(&q);
+    enum ss_tm_err e = ss_tm_bigint_copy(&q, a);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    if(b->size == 1) {
+        ss_tm_bigint_div_limb(q.limbs, q.size, b->limbs[0]);
+    } else {
+        // Binary long division. Rounds are one bit of a each, but divisors
+        // this wide only come up when applying rules, which is rare.
+        struct ss_tm_bigint remainder;
+        ss_tm_bigint_init(&remainder);
+        e = ss_tm_bigint_reserve(&remainder, b->size + 1);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            ss_tm_bigint_destroy(&q);
+            return e;
+        }
+        struct ss_tm_bigint divisor = *b;
+        divisor.negative = false;
+        memset(q.limbs, 0, q.size * sizeof(uint32_t));
+        size_t bit = a->size * 32;
+        while(bit > 0) {
+            bit--;
+            // remainder = remainder * 2 + bit of a.
+            uint32_t carry = (a->limbs[bit / 32] >> (bit % 32)) & 1;
+            size_t i;
+            for(i = 0; i < remainder.size; i++) {
+                uint32_t next_carry = remainder.limbs[i] >> 31;
+                remainder.limbs[i] = (remainder.limbs[i] << 1) | carry;
+                carry = next_carry;
+            }
+            if(carry)
+                remainder.limbs[remainder.size++] = carry;
+            if(ss_tm_bigint_cmp_magnitude(&remainder, &divisor) >= 0) {
+                ss_tm_bigint_sub(&remainder, &remainder, &divisor);
+                q.limbs[bit / 32] |= 1u << (bit % 32);
+            }
+        }
+        ss_tm_bigint_destroy(&remainder);
+    }
+    q.negative = negative;
+    ss_tm_bigint_normalize(&q);
+
+    ss_tm_bigint_destroy(quotient);
+    *quotient = q;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    int
+ss_tm_bigint_cmp(
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b) {
+
+    if(a->negative != b->negative)
+        return a->negative ? -1 : 1;
+    int c = ss_tm_bigint_cmp_magnitude(a, b);
+    return a->negative ? -c : c;
+}
+
+    int
+ss_tm_bigint_cmp_i64(
+    const struct ss_tm_bigint *a,
+    int64_t b) {
+
+    uint32_t limbs[2];
+    struct ss_tm_bigint wrapped;
+    ss_tm_bigint_wrap_i64(&wrapped, limbs, b);
+    return ss_tm_bigint_cmp(a, &wrapped);
+}
+
+    int
+ss_tm_bigint_sign(
+    const struct ss_tm_bigint *a) {
+
+    if(a->size == 0)
+        return 0;
+    return a->negative ? -1 : 1;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_to_u64(
+    const struct ss_tm_bigint *a,
+    uint64_t *out_value) {
+
+    if(a->negative || a->size > 2)
+        return SS_TM_ERR_OUT_OF_RANGE;
+    uint64_t value = 0;
+    if(a->size > 0)
+        value = a->limbs[0];
+    if(a->size > 1)
+        value |= (uint64_t)a->limbs[1] << 32;
+    *out_value = value;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_bigint_to_str(
+    const struct ss_tm_bigint *a,
+    char **out_str) {
+
+    // Each limb is under 10 digits, and chunks of 9 digits come off at a time.
+    size_t max_chunks = a->size * 10 / 9 + 2;
+    uint32_t *chunks = (uint32_t *)malloc(max_chunks * sizeof(uint32_t));
+    uint32_t *limbs = (uint32_t *)malloc((a->size + 1) * sizeof(uint32_t));
+    char *str = (char *)malloc(max_chunks * 9 + 2);
+    if(!chunks || !limbs || !str) {
+        free(chunks);
+        free(limbs);
+        free(str);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+
+    size_t size = a->size;
+    if(size)
+        memcpy(limbs, a->limbs, size * sizeof(uint32_t));
+    size_t num_chunks = 0;
+    do {
+        chunks[num_chunks++] = ss_tm_bigint_div_limb(limbs, size, 1000000000u);
+        while(size > 0 && limbs[size - 1] == 0)
+            size--;
+    } while(size > 0);
+
+    char *p = str;
+    if(a->negative)
+        *p++ = '-';
+    p += sprintf(p, "%u", chunks[num_chunks - 1]);
+    size_t i = num_chunks - 1;
+    while(i > 0) {
+        i--;
+        p += sprintf(p, "%09u", chunks[i]);
+    }
+
+    free(chunks);
+    free(limbs);
+    *out_str = str;
+    return SS_TM_ERR_NO_ERROR;
+}
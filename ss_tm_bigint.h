@@ -0,0 +1,110 @@
+#ifndef ss_tm_bigint_h
+#define ss_tm_bigint_h
+
+#include "ss_tm.h"
+
+// Arbitrary-precision signed integers, for step counts and run lengths too
+// big for 64 bits (see ss_tm_accel.h). The magnitude is stored as base 2^32
+// limbs, least significant first, with no leading zero limbs; zero has no
+// limbs and isn't negative.
+//
+// Results may alias operands. Only allocation can fail, except where noted.
+
+struct ss_tm_bigint {
+    uint32_t *limbs;
+    size_t size;
+    size_t capacity;
+    bool negative;
+};
+
+// Sets self to zero without allocating.
+    enum ss_tm_err
+ss_tm_bigint_init(
+    struct ss_tm_bigint *self);
+
+    enum ss_tm_err
+ss_tm_bigint_destroy(
+    struct ss_tm_bigint *self);
+
+    enum ss_tm_err
+ss_tm_bigint_set_i64(
+    struct ss_tm_bigint *self,
+    int64_t value);
+
+    enum ss_tm_err
+ss_tm_bigint_set_u64(
+    struct ss_tm_bigint *self,
+    uint64_t value);
+
+    enum ss_tm_err
+ss_tm_bigint_copy(
+    struct ss_tm_bigint *self,
+    const struct ss_tm_bigint *value);
+
+    enum ss_tm_err
+ss_tm_bigint_add(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b);
+
+    enum ss_tm_err
+ss_tm_bigint_sub(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b);
+
+    enum ss_tm_err
+ss_tm_bigint_mul(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b);
+
+    enum ss_tm_err
+ss_tm_bigint_add_i64(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    int64_t b);
+
+    enum ss_tm_err
+ss_tm_bigint_mul_i64(
+    struct ss_tm_bigint *result,
+    const struct ss_tm_bigint *a,
+    int64_t b);
+
+// Divides a by b, rounding toward zero. Fails with SS_TM_ERR_OUT_OF_RANGE if
+// b is zero.
+    enum ss_tm_err
+ss_tm_bigint_div(
+    struct ss_tm_bigint *quotient,
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b);
+
+// Negative, zero, or positive as a is less than, equal to, or greater than b.
+    int
+ss_tm_bigint_cmp(
+    const struct ss_tm_bigint *a,
+    const struct ss_tm_bigint *b);
+
+    int
+ss_tm_bigint_cmp_i64(
+    const struct ss_tm_bigint *a,
+    int64_t b);
+
+// -1, 0, or 1.
+    int
+ss_tm_bigint_sign(
+    const struct ss_tm_bigint *a);
+
+// Fails with SS_TM_ERR_OUT_OF_RANGE if a is negative or doesn't fit.
+    enum ss_tm_err
+ss_tm_bigint_to_u64(
+    const struct ss_tm_bigint *a,
+    uint64_t *out_value);
+
+// Writes a in decimal to a string the caller must free.
+    enum ss_tm_err
+ss_tm_bigint_to_str(
+    const struct ss_tm_bigint *a,
+    char **out_str);
+
+#endif // #ifndef ss_tm_bigint_h
@@ -0,0 +1,483 @@
+#include "ss_tm_db.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Room for the index of the largest machine; see ss_tm_init_static.
+#define SS_TM_DB_INDEX_CAPACITY 512
+
+// Text is split into chunks of about this many bytes, each starting at the
+// first line beginning in it, and seed files into chunks of this many
+// records. Workers take one chunk at a time.
+#define SS_TM_DB_TEXT_CHUNK_SIZE (1u << 20)
+#define SS_TM_DB_SEED_CHUNK_SIZE 4096
+
+struct ss_tm_db_shared {
+    const char *data;
+    size_t data_size;
+
+    // Seed files only. num_states is 0 for compact notation text.
+    size_t header_size;
+    size_t num_states;
+    size_t num_symbols;
+    size_t record_size;
+
+    size_t num_chunks;
+    // Text only. While counting, workers store the number of lines in each
+    // chunk here; the counts are then turned into the index of each chunk's
+    // first line.
+    uint64_t *chunk_lines;
+    bool counting;
+
+    ss_tm_db_machine_fn on_machine;
+    void *user_data;
+
+    // Guards the fields below, except stop, which workers also poll without
+    // it.
+    pthread_mutex_t lock;
+    size_t next_chunk;
+    size_t next_worker;
+    bool stop;
+    enum ss_tm_err err;
+    uint64_t bad_index;
+};
+
+    enum ss_tm_err
+ss_tm_db_parse_compact(
+    const char *text,
+    size_t text_size,
+    struct ss_tm_transition *out_transitions,
+    size_t *out_num_transitions) {
+
+    // The first group gives the number of symbols, and the length then gives
+    // the number of states.
+    size_t group_size = 0;
+    while(group_size < text_size && text[group_size] != '_')
+        group_size++;
+    size_t num_symbols = group_size / 3;
+    if(group_size % 3 != 0 || num_symbols == 0 || num_symbols > SS_TM_DB_MAX_SYMBOLS)
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    size_t num_states = (text_size + 1) / (group_size + 1);
+    if(num_states > SS_TM_DB_MAX_STATES || num_states * (group_size + 1) != text_size + 1)
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+
+    size_t num_transitions = 0;
+    size_t s;
+    for(s = 0; s < num_states; s++) {
+        const char *group = text + s * (group_size + 1);
+        if(s > 0 && group[-1] != '_')
+            return SS_TM_ERR_BAD_FILE_FORMAT;
+        size_t c;
+        for(c = 0; c < num_symbols; c++) {
+            const char *triple = group + 3 * c;
+            if(triple[0] == '-' && triple[1] == '-' && triple[2] == '-')
+                continue;
+
+            size_t out_char = (size_t)(unsigned char)(triple[0] - '0');
+            size_t out_state = (size_t)(unsigned char)(triple[2] - 'A');
+            if(out_char >= num_symbols ||
+                (triple[1] != 'L' && triple[1] != 'R') ||
+                (out_state >= num_states && triple[2] != 'Z')) {
+
+                return SS_TM_ERR_BAD_FILE_FORMAT;
+            }
+
+            struct ss_tm_transition *t = &out_transitions[num_transitions++];
+            t->in_state = SS_TM_INITIAL_STATE + s;
+            t->in_char = c;
+            t->out_state = triple[2] == 'Z' ?
+                SS_TM_ACCEPT_STATE : SS_TM_INITIAL_STATE + out_state;
+            t->out_char = out_char;
+            t->out_right = triple[1] == 'R';
+        }
+    }
+    *out_num_transitions = num_transitions;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static enum ss_tm_err
+ss_tm_db_parse_seed(
+    const struct ss_tm_db_shared *shared,
+    const uint8_t *record,
+    struct ss_tm_transition *out_transitions,
+    size_t *out_num_transitions) {
+
+    size_t num_transitions = 0;
+    size_t s;
+    for(s = 0; s < shared->num_states; s++) {
+        size_t c;
+        for(c = 0; c < shared->num_symbols; c++) {
+            const uint8_t *triple = record + 3 * (s * shared->num_symbols + c);
+            if(triple[0] >= shared->num_symbols || triple[1] > 1 ||
+                triple[2] > shared->num_states) {
+
+                return SS_TM_ERR_BAD_FILE_FORMAT;
+            }
+            if(triple[2] == 0)
+                continue;
+
+            struct ss_tm_transition *t = &out_transitions[num_transitions++];
+            t->in_state = SS_TM_INITIAL_STATE + s;
+            t->in_char = c;
+            t->out_state = SS_TM_INITIAL_STATE + triple[2] - 1;
+            t->out_char = triple[0];
+            t->out_right = triple[1] == 0;
+        }
+    }
+    *out_num_transitions = num_transitions;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Returns the offset of the first line starting at or after offset.
+    static size_t
+ss_tm_db_line_start(
+    const struct ss_tm_db_shared *shared,
+    size_t offset) {
+
+    if(offset == 0)
+        return 0;
+    if(offset >= shared->data_size)
+        return shared->data_size;
+    const char *newline = (const char *)memchr(
+        shared->data + offset - 1,
+        '\n',
+        shared->data_size - (offset - 1));
+    return newline ? (size_t)(newline - shared->data) + 1 : shared->data_size;
+}
+
+// Stops the load, keeping the earliest bad index if there are several.
+    static void
+ss_tm_db_fail(
+    struct ss_tm_db_shared *shared,
+    enum ss_tm_err e,
+    uint64_t bad_index) {
+
+    pthread_mutex_lock(&shared->lock);
+    if(shared->err == SS_TM_ERR_NO_ERROR || bad_index < shared->bad_index) {
+        shared->err = e;
+        shared->bad_index = bad_index;
+    }
+    __atomic_store_n(&shared->stop, true, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// Decoded transitions, and the machine re-initialized over them for each
+// machine a worker loads.
+struct ss_tm_db_worker_state {
+    size_t worker;
+    struct ss_tm tm;
+    bool tm_set_up;
+    struct ss_tm_transition transitions[SS_TM_DB_MAX_TRANSITIONS];
+    size_t index[SS_TM_DB_INDEX_CAPACITY];
+};
+
+    static void
+ss_tm_db_deliver(
+    struct ss_tm_db_shared *shared,
+    struct ss_tm_db_worker_state *state,
+    uint64_t machine_index,
+    size_t num_transitions) {
+
+    enum ss_tm_err e;
+    if(state->tm_set_up) {
+        e = ss_tm_reinit_static(&state->tm, state->transitions, num_transitions,
+            state->index, SS_TM_DB_INDEX_CAPACITY);
+    } else {
+        e = ss_tm_init_static(&state->tm, state->transitions, num_transitions,
+            state->index, SS_TM_DB_INDEX_CAPACITY);
+        state->tm_set_up = true;
+    }
+    if(e != SS_TM_ERR_NO_ERROR) {
+        ss_tm_db_fail(shared, e, machine_index);
+        return;
+    }
+    if(!shared->on_machine(shared->user_data, state->worker, machine_index, &state->tm))
+        __atomic_store_n(&shared->stop, true, __ATOMIC_RELAXED);
+}
+
+    static void
+ss_tm_db_run_text_chunk(
+    struct ss_tm_db_shared *shared,
+    struct ss_tm_db_worker_state *state,
+    size_t chunk) {
+
+    size_t p = ss_tm_db_line_start(shared, chunk * (size_t)SS_TM_DB_TEXT_CHUNK_SIZE);
+    size_t end = ss_tm_db_line_start(shared, (chunk + 1) * (size_t)SS_TM_DB_TEXT_CHUNK_SIZE);
+    uint64_t line_index = shared->counting ? 0 : shared->chunk_lines[chunk];
+    while(p < end) {
+        const char *line = shared->data + p;
+        const char *newline = (const char *)memchr(line, '\n', end - p);
+        size_t line_size = newline ? (size_t)(newline - line) : end - p;
+        p += line_size + 1;
+
+        if(!shared->counting) {
+            if(__atomic_load_n(&shared->stop, __ATOMIC_RELAXED))
+                return;
+            if(line_size > 0 && line[line_size - 1] == '\r')
+                line_size--;
+            if(line_size > 0) {
+                size_t num_transitions;
+                enum ss_tm_err e = ss_tm_db_parse_compact(
+                    line, line_size, state->transitions, &num_transitions);
+                if(e != SS_TM_ERR_NO_ERROR) {
+                    ss_tm_db_fail(shared, e, line_index);
+                    return;
+                }
+                ss_tm_db_deliver(shared, state, line_index, num_transitions);
+            }
+        }
+        line_index++;
+    }
+    if(shared->counting)
+        shared->chunk_lines[chunk] = line_index;
+}
+
+    static void
+ss_tm_db_run_seed_chunk(
+    struct ss_tm_db_shared *shared,
+    struct ss_tm_db_worker_state *state,
+    size_t chunk) {
+
+    uint64_t num_records = (shared->data_size - shared->header_size) / shared->record_size;
+    uint64_t r = (uint64_t)chunk * SS_TM_DB_SEED_CHUNK_SIZE;
+    uint64_t end = r + SS_TM_DB_SEED_CHUNK_SIZE;
+    if(end > num_records)
+        end = num_records;
+    for(; r < end; r++) {
+        if(__atomic_load_n(&shared->stop, __ATOMIC_RELAXED))
+            return;
+        const uint8_t *record = (const uint8_t *)shared->data +
+            shared->header_size + r * shared->record_size;
+        size_t num_transitions;
+        enum ss_tm_err e = ss_tm_db_parse_seed(
+            shared, record, state->transitions, &num_transitions);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            ss_tm_db_fail(shared, e, r);
+            return;
+        }
+        ss_tm_db_deliver(shared, state, r, num_transitions);
+    }
+}
+
+    static void *
+ss_tm_db_worker(
+    void *arg) {
+
+    struct ss_tm_db_shared *shared = (struct ss_tm_db_shared *)arg;
+    // Too big to want on every thread's stack.
+    struct ss_tm_db_worker_state *state = (struct ss_tm_db_worker_state *)malloc(
+        sizeof(struct ss_tm_db_worker_state));
+    if(!state) {
+        ss_tm_db_fail(shared, SS_TM_ERR_ALLOCATION_FAILED, UINT64_MAX);
+        return NULL;
+    }
+    state->tm_set_up = false;
+
+    pthread_mutex_lock(&shared->lock);
+    state->worker = shared->next_worker++;
+    pthread_mutex_unlock(&shared->lock);
+
+    while(true) {
+        pthread_mutex_lock(&shared->lock);
+        if(__atomic_load_n(&shared->stop, __ATOMIC_RELAXED) ||
+            shared->next_chunk == shared->num_chunks) {
+
+
+            pthread_mutex_unlock(&shared->lock);
+            break;
+        }
+        size_t chunk = shared->next_chunk++;
+        pthread_mutex_unlock(&shared->lock);
+
+        if(shared->num_states == 0)
+            ss_tm_db_run_text_chunk(shared, state, chunk);
+        else
+            ss_tm_db_run_seed_chunk(shared, state, chunk);
+    }
+
+    if(state->tm_set_up)
+        ss_tm_destroy(&state->tm);
+    free(state);
+    return NULL;
+}
+
+    static enum ss_tm_err
+ss_tm_db_run_workers(
+    struct ss_tm_db_shared *shared,
+    size_t num_threads) {
+
+    if(num_threads > shared->num_chunks)
+        num_threads = shared->num_chunks;
+    if(num_threads == 0)
+        return SS_TM_ERR_NO_ERROR;
+
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    if(!threads)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    shared->next_chunk = 0;
+    shared->next_worker = 0;
+
+    enum ss_tm_err result = SS_TM_ERR_NO_ERROR;
+    size_t num_started;
+    for(num_started = 0; num_started < num_threads; num_started++) {
+        if(pthread_create(&threads[num_started], NULL, ss_tm_db_worker, shared)) {
+            result = SS_TM_ERR_THREAD_CREATE_FAILED;
+            break;
+        }
+    }
+    // Workers that did start still take every chunk, so a partial failure
+    // only costs parallelism.
+    if(num_started > 0)
+        result = SS_TM_ERR_NO_ERROR;
+
+    size_t i;
+    for(i = 0; i < num_started; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+    return result;
+}
+
+// Maps path and runs the load described by shared, which needs everything
+// but the data and chunks filled in.
+    static enum ss_tm_err
+ss_tm_db_load(
+    struct ss_tm_db_shared *shared,
+    const char *path,
+    size_t num_threads,
+    uint64_t *out_num_machines,
+    uint64_t *out_bad_index) {
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return SS_TM_ERR_IO_FAILED;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return SS_TM_ERR_IO_FAILED;
+    }
+    shared->data_size = st.st_size;
+    shared->data = NULL;
+    if(shared->data_size > 0) {
+        void *data = mmap(NULL, shared->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            close(fd);
+            return SS_TM_ERR_IO_FAILED;
+        }
+        madvise(data, shared->data_size, MADV_SEQUENTIAL);
+        shared->data = (const char *)data;
+    }
+    close(fd);
+
+    if(num_threads == 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = num_cpus > 0 ? (size_t)num_cpus : 1;
+    }
+    pthread_mutex_init(&shared->lock, NULL);
+    shared->stop = false;
+    shared->err = SS_TM_ERR_NO_ERROR;
+    shared->bad_index = 0;
+    shared->chunk_lines = NULL;
+
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    uint64_t num_machines = 0;
+    if(shared->num_states == 0) {
+        shared->num_chunks = (shared->data_size + SS_TM_DB_TEXT_CHUNK_SIZE - 1) /
+            SS_TM_DB_TEXT_CHUNK_SIZE;
+        shared->chunk_lines = (uint64_t *)malloc(sizeof(uint64_t) * (shared->num_chunks + 1));
+        if(!shared->chunk_lines)
+            e = SS_TM_ERR_ALLOCATION_FAILED;
+
+        // Count the lines in each chunk first, so that every line's index is
+        // known when the chunks are parsed out of order.
+        if(e == SS_TM_ERR_NO_ERROR) {
+            shared->counting = true;
+            e = ss_tm_db_run_workers(shared, num_threads);
+        }
+        if(e == SS_TM_ERR_NO_ERROR) {
+            size_t c;
+            for(c = 0; c < shared->num_chunks; c++) {
+                uint64_t lines = shared->chunk_lines[c];
+                shared->chunk_lines[c] = num_machines;
+                num_machines += lines;
+            }
+            shared->counting = false;
+            e = ss_tm_db_run_workers(shared, num_threads);
+        }
+    } else {
+        if(shared->data_size < shared->header_size ||
+            (shared->data_size - shared->header_size) % shared->record_size != 0) {
+
+            e = SS_TM_ERR_BAD_FILE_FORMAT;
+        } else {
+            num_machines = (shared->data_size - shared->header_size) / shared->record_size;
+            shared->num_chunks = (num_machines + SS_TM_DB_SEED_CHUNK_SIZE - 1) /
+                SS_TM_DB_SEED_CHUNK_SIZE;
+            e = ss_tm_db_run_workers(shared, num_threads);
+        }
+    }
+    if(e == SS_TM_ERR_NO_ERROR)
+        e = shared->err;
+    if(e == SS_TM_ERR_BAD_FILE_FORMAT && shared->err == e && out_bad_index)
+        *out_bad_index = shared->bad_index;
+    if(out_num_machines)
+        *out_num_machines = num_machines;
+
+    free(shared->chunk_lines);
+    pthread_mutex_destroy(&shared->lock);
+    if(shared->data)
+        munmap((void *)shared->data, shared->data_size);
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_db_load_compact(
+    const char *path,
+    size_t num_threads,
+    ss_tm_db_machine_fn on_machine,
+    void *user_data,
+    uint64_t *out_num_machines,
+    uint64_t *out_bad_index) {
+
+    struct ss_tm_db_shared shared;
+    shared.header_size = 0;
+    shared.num_states = 0;
+    shared.num_symbols = 0;
+    shared.record_size = 0;
+    shared.on_machine = on_machine;
+    shared.user_data = user_data;
+    return ss_tm_db_load(&shared, path, num_threads, out_num_machines, out_bad_index);
+}
+
+    enum ss_tm_err
+ss_tm_db_load_seeds(
+    const char *path,
+    size_t header_size,
+    size_t num_states,
+    size_t num_symbols,
+    size_t num_threads,
+    ss_tm_db_machine_fn on_machine,
+    void *user_data,
+    uint64_t *out_num_machines,
+    uint64_t *out_bad_index) {
+
+    if(num_states == 0 || num_states > SS_TM_DB_MAX_STATES ||
+        num_symbols == 0 || num_symbols > SS_TM_DB_MAX_SYMBOLS) {
+
+        return SS_TM_ERR_OUT_OF_RANGE;
+    }
+
+    struct ss_tm_db_shared shared;
+    shared.header_size = header_size;
+    shared.num_states = num_states;
+    shared.num_symbols = num_symbols;
+    shared.record_size = 3 * num_states * num_symbols;
+    shared.on_machine = on_machine;
+    shared.user_data = user_data;
+    return ss_tm_db_load(&shared, path, num_threads, out_num_machines, out_bad_index);
+}
@@ -0,0 +1,91 @@
+#ifndef ss_tm_db_h
+#define ss_tm_db_h
+
+#include "ss_tm.h"
+
+// Loads databases of many small machines and hands each one, initialized and
+// ready to simulate, to a callback on one of several worker threads. The file
+// is mapped rather than read, and each worker decodes into its own fixed
+// buffers and re-initializes one machine over them (see ss_tm_reinit_static),
+// so nothing is allocated per machine and the tape is reused from one machine
+// to the next.
+//
+// Two formats are understood:
+//
+// Compact notation text, one machine per line, e.g. "1RB1LC_1RC1RB_1RD0LE_...".
+// Each state is a group of three characters per symbol, giving the symbol to
+// write, the direction, and the next state. States are the letters A to Y and
+// map to SS_TM_INITIAL_STATE + 0, 1, ..., so A is the initial state; Z means
+// halt and maps to SS_TM_ACCEPT_STATE. A group of "---" leaves the transition
+// undefined, so the machine rejects there. Symbols are the digits 0 up to the
+// number of symbols per state, and map to the same tape characters, so 0 is
+// the blank. Empty lines are skipped.
+//
+// Seed records, as in the busy beaver challenge's seed database: a header of
+// header_size bytes, then fixed-size records, each holding three bytes per
+// (state, symbol) in state-major order: the symbol to write, the direction
+// (0 right, 1 left), and the next state, 1-based, with 0 leaving the
+// transition undefined.
+//
+// The compact notation is for two-way tapes, and so are most machines written
+// in it; the caller decides how to start them on the one-way tape, e.g. in
+// the middle of a padded input.
+
+// Up to 25 states (A to Y) and 10 symbols (0 to 9).
+#define SS_TM_DB_MAX_STATES 25
+#define SS_TM_DB_MAX_SYMBOLS 10
+#define SS_TM_DB_MAX_TRANSITIONS (SS_TM_DB_MAX_STATES * SS_TM_DB_MAX_SYMBOLS)
+
+// Receives the machine_index'th machine of the database (its line number in
+// a text file, counting from 0, or its record number). tm is only valid for
+// the duration of the call. worker identifies the calling thread, from 0 up to
+// the number of threads, so callbacks can keep per-thread state. Called
+// concurrently and in no particular order. Returns false to stop the load
+// early.
+typedef bool (*ss_tm_db_machine_fn)(
+    void *user_data,
+    size_t worker,
+    uint64_t machine_index,
+    struct ss_tm *tm);
+
+// Decodes one machine in compact notation, the text_size characters at text,
+// into out_transitions, which needs room for SS_TM_DB_MAX_TRANSITIONS.
+// Fails with SS_TM_ERR_BAD_FILE_FORMAT if it isn't valid compact notation.
+    enum ss_tm_err
+ss_tm_db_parse_compact(
+    const char *text,
+    size_t text_size,
+    struct ss_tm_transition *out_transitions,
+    size_t *out_num_transitions);
+
+// Loads every machine of the compact notation text file at path. num_threads
+// of 0 uses one thread per online CPU. out_num_machines, if not NULL,
+// receives the number of lines in the file. If a line can't be parsed the
+// load stops with SS_TM_ERR_BAD_FILE_FORMAT, and out_bad_index, if not NULL,
+// receives the index of the bad line. (With several threads, a bad line
+// further on may be found and reported first.)
+    enum ss_tm_err
+ss_tm_db_load_compact(
+    const char *path,
+    size_t num_threads,
+    ss_tm_db_machine_fn on_machine,
+    void *user_data,
+    uint64_t *out_num_machines,
+    uint64_t *out_bad_index);
+
+// Loads every machine of the seed record file at path; as
+// ss_tm_db_load_compact otherwise. The challenge's database has a 30-byte
+// header, 5 states and 2 symbols.
+    enum ss_tm_err
+ss_tm_db_load_seeds(
+    const char *path,
+    size_t header_size,
+    size_t num_states,
+    size_t num_symbols,
+    size_t num_threads,
+    ss_tm_db_machine_fn on_machine,
+    void *user_data,
+    uint64_t *out_num_machines,
+    uint64_t *out_bad_index);
+
+#endif // #ifndef ss_tm_db_h
@@ -0,0 +1,41 @@
+#ifndef ss_tm_hash_h
+#define ss_tm_hash_h
+
+#include <inttypes.h>
+
+// Polynomial hashes modulo 2^61 - 1, for tape views (see ss_tm_view.h) and
+// the nondeterministic search's visited set (ss_tm_ntm.c). A sequence of
+// cells hashes to the sum of digit(cell i) * base^(n - 1 - i), where a cell's
+// digit is never 0, so blanks count wherever they are.
+#define SS_TM_HASH_MODULUS ((1ull << 61) - 1)
+#define SS_TM_HASH_BASE 0x1F6BD5A2E3C48F97ull
+
+    static inline uint64_t
+ss_tm_hash_reduce(
+    unsigned __int128 x) {
+
+    // 2^61 = 1 modulo 2^61 - 1, so the high bits fold onto the low ones.
+    uint64_t r = (uint64_t)(x & SS_TM_HASH_MODULUS) + (uint64_t)(x >> 61);
+    r = (r & SS_TM_HASH_MODULUS) + (r >> 61);
+    return r >= SS_TM_HASH_MODULUS ? r - SS_TM_HASH_MODULUS : r;
+}
+
+    static inline uint64_t
+ss_tm_hash_mul(
+    uint64_t a,
+    uint64_t b) {
+
+    return ss_tm_hash_reduce((unsigned __int128)a * b);
+}
+
+// Maps a cell to its digit in the hash, in 1..SS_TM_HASH_MODULUS. Cells
+// congruent modulo SS_TM_HASH_MODULUS share a digit, so hashes can collide
+// on them; compare the cells on a match where that matters.
+    static inline uint64_t
+ss_tm_hash_digit(
+    uint64_t cell) {
+
+    return ss_tm_hash_reduce(cell) + 1;
+}
+
+#endif // #ifndef ss_tm_hash_h
@@ -0,0 +1,265 @@
+#include "ss_tm_image.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char ss_tm_image_magic[8] = {'S', 'S', 'T', 'M', 'I', 'M', 'G', '1'};
+
+    static uint64_t
+ss_tm_image_align(
+    uint64_t offset) {
+
+    return (offset + SS_TM_IMAGE_ALIGNMENT - 1) & ~(uint64_t)(SS_TM_IMAGE_ALIGNMENT - 1);
+}
+
+// Pads f with zeros up to offset.
+    static void
+ss_tm_image_pad(
+    FILE *f,
+    uint64_t *written,
+    uint64_t offset) {
+
+    while(*written < offset) {
+        fputc(0, f);
+        (*written)++;
+    }
+}
+
+    enum ss_tm_err
+ss_tm_image_write(
+    const struct ss_tm *machine,
+    bool include_tape,
+    const char *path) {
+
+    if(!machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    // The format has no flag for them yet.
+    if(machine->nondeterministic)
+        return SS_TM_ERR_NONDETERMINISTIC_MACHINE;
+
+    struct ss_tm_image_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ss_tm_image_magic, sizeof(header.magic));
+    header.version = SS_TM_IMAGE_VERSION;
+    header.byte_order_mark = SS_TM_IMAGE_BYTE_ORDER_MARK;
+    header.transition_size = sizeof(struct ss_tm_transition);
+    header.word_size = sizeof(size_t);
+
+    header.transitions_offset = ss_tm_image_align(sizeof(header));
+    header.transitions_end = machine->transitions_end;
+    header.index_offset = ss_tm_image_align(
+        header.transitions_offset + header.transitions_end * sizeof(struct ss_tm_transition));
+    header.index_size = machine->index_mask + 1;
+    header.file_size = header.index_offset + header.index_size * sizeof(size_t);
+
+    if(include_tape && machine->simulation_started) {
+        // Cells past both the head and the last non-blank cell are implied.
+        size_t num_cells = machine->tape_size;
+        while(num_cells > machine->tape_head + 1 && machine->tape[num_cells - 1] == 0)
+            num_cells--;
+
+        header.has_tape = 1;
+        header.tape_offset = ss_tm_image_align(header.file_size);
+        header.tape_size = num_cells;
+        header.tape_head = machine->tape_head;
+        header.state = machine->state;
+        header.steps = machine->steps;
+        header.file_size = header.tape_offset + num_cells * sizeof(uint64_t);
+    }
+
+    size_t tmp_path_size = strlen(path) + sizeof(".tmp");
+    char *tmp_path = (char *)malloc(tmp_path_size);
+    if(!tmp_path)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    snprintf(tmp_path, tmp_path_size, "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if(!f) {
+        free(tmp_path);
+        return SS_TM_ERR_IO_FAILED;
+    }
+
+    uint64_t written = 0;
+    fwrite(&header, sizeof(header), 1, f);
+    written += sizeof(header);
+
+    ss_tm_image_pad(f, &written, header.transitions_offset);
+    size_t i;
+    for(i = 0; i < machine->transitions_end; i++) {
+        // Copied field by field so the struct's padding is written as zeros,
+        // and equal machines give identical images.
+        struct ss_tm_transition t;
+        memset(&t, 0, sizeof(t));
+        t.in_state = machine->transitions[i].in_state;
+        t.in_char = machine->transitions[i].in_char;
+        t.out_state = machine->transitions[i].out_state;
+        t.out_char = machine->transitions[i].out_char;
+        t.out_right = machine->transitions[i].out_right;
+        fwrite(&t, sizeof(t), 1, f);
+        written += sizeof(t);
+    }
+
+    ss_tm_image_pad(f, &written, header.index_offset);
+    fwrite(machine->index, sizeof(size_t), header.index_size, f);
+    written += header.index_size * sizeof(size_t);
+
+    if(header.has_tape) {
+        ss_tm_image_pad(f, &written, header.tape_offset);
+        fwrite(machine->tape, sizeof(uint64_t), header.tape_size, f);
+        written += header.tape_size * sizeof(uint64_t);
+    }
+
+    bool ok = !ferror(f) && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if(!ok)
+        unlink(tmp_path);
+    free(tmp_path);
+    return ok ? SS_TM_ERR_NO_ERROR : SS_TM_ERR_IO_FAILED;
+}
+
+// Checks that count elements of the given size at offset lie within the
+// file and are aligned.
+    static bool
+ss_tm_image_section_ok(
+    const struct ss_tm_image_header *header,
+    uint64_t offset,
+    uint64_t count,
+    uint64_t size) {
+
+    return offset % SS_TM_IMAGE_ALIGNMENT == 0 &&
+        offset <= header->file_size &&
+        count <= (header->file_size - offset) / size;
+}
+
+    static bool
+ss_tm_image_header_ok(
+    const struct ss_tm_image_header *header,
+    size_t data_size) {
+
+    if(memcmp(header->magic, ss_tm_image_magic, sizeof(header->magic)) != 0 ||
+        header->version != SS_TM_IMAGE_VERSION ||
+        header->byte_order_mark != SS_TM_IMAGE_BYTE_ORDER_MARK ||
+        header->transition_size != sizeof(struct ss_tm_transition) ||
+        header->word_size != sizeof(size_t) ||
+        header->file_size != data_size) {
+
+        return false;
+    }
+
+    // The index must be a power of two with at least one empty slot, so
+    // failed lookups terminate.
+    if(header->index_size == 0 ||
+        (header->index_size & (header->index_size - 1)) != 0 ||
+        header->index_size <= header->transitions_end) {
+
+        return false;
+    }
+
+    if(!ss_tm_image_section_ok(header, header->transitions_offset,
+            header->transitions_end, sizeof(struct ss_tm_transition)) ||
+        !ss_tm_image_section_ok(header, header->index_offset,
+            header->index_size, sizeof(size_t))) {
+
+        return false;
+    }
+
+    if(header->has_tape) {
+        if(header->tape_size == 0 ||
+            header->tape_head >= header->tape_size ||
+            !ss_tm_image_section_ok(header, header->tape_offset,
+                header->tape_size, sizeof(uint64_t))) {
+
+            return false;
+        }
+    }
+    return true;
+}
+
+    enum ss_tm_err
+ss_tm_image_open(
+    struct ss_tm_image *self,
+    const char *path) {
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return SS_TM_ERR_IO_FAILED;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return SS_TM_ERR_IO_FAILED;
+    }
+    if((size_t)st.st_size < sizeof(struct ss_tm_image_header)) {
+        close(fd);
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return SS_TM_ERR_IO_FAILED;
+
+    const struct ss_tm_image_header *header = (const struct ss_tm_image_header *)data;
+    if(!ss_tm_image_header_ok(header, st.st_size)) {
+        munmap(data, st.st_size);
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    }
+
+    // A stand-in owner for the mapped table, so self->machine can borrow it
+    // like any other machine's. The pages are read-only, which is fine:
+    // nothing writes to an initialized machine's table.
+    struct ss_tm owner;
+    memset(&owner, 0, sizeof(owner));
+    owner.init = true;
+    owner.transitions = (struct ss_tm_transition *)((char *)data + header->transitions_offset);
+    owner.transitions_end = header->transitions_end;
+    owner.transitions_size = header->transitions_end;
+    owner.index = (size_t *)((char *)data + header->index_offset);
+    owner.index_mask = header->index_size - 1;
+    owner.nondeterministic = false;
+
+    enum ss_tm_err e = ss_tm_init_borrow(&self->machine, &owner);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        munmap(data, st.st_size);
+        return e;
+    }
+
+    self->data = data;
+    self->data_size = st.st_size;
+    self->header = header;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_image_simulation_begin(
+    const struct ss_tm_image *self,
+    struct ss_tm *tm) {
+
+    if(!tm->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    if(!self->header->has_tape)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    // The mapping is read-only, so the tape is copied into the machine's 
+    // own, under its space limits.
+    return ss_tm_simulation_resume(
+        tm,
+        (const uint64_t *)((const char *)self->data + self->header->tape_offset),
+        self->header->tape_size,
+        self->header->tape_head,
+        self->header->state,
+        self->header->steps);
+}
+
+    enum ss_tm_err
+ss_tm_image_close(
+    struct ss_tm_image *self) {
+
+    ss_tm_destroy(&self->machine);
+    munmap((void *)self->data, self->data_size);
+    return SS_TM_ERR_NO_ERROR;
+}
@@ -0,0 +1,97 @@
+#ifndef ss_tm_image_h
+#define ss_tm_image_h
+
+#include "ss_tm.h"
+
+// Machine images: an initialized machine's transition table and index,
+// written to a file exactly as they sit in memory, so that loading one is a
+// single mmap with no parsing, copying, or rehashing. The mapping is
+// read-only and shared, so every process loading the same image shares its
+// pages through the page cache.
+//
+// An image may also hold a snapshot of a simulation (tape, head, state and
+// step count) to resume from.
+//
+// The file starts with struct ss_tm_image_header. The transitions, index and
+// tape follow at the offsets it gives, each aligned to
+// SS_TM_IMAGE_ALIGNMENT. Everything is in host byte order with host struct
+// layout; the header records enough about both (a byte order mark and the
+// sizes of a transition and of size_t) for a different host to refuse the
+// image instead of misreading it.
+//
+// Only the header is checked when loading. The table itself is trusted, as a
+// shared library would be: a corrupted index can make lookups read out of
+// bounds.
+
+#define SS_TM_IMAGE_VERSION 1
+#define SS_TM_IMAGE_BYTE_ORDER_MARK 0x0102030405060708ull
+#define SS_TM_IMAGE_ALIGNMENT 64
+
+struct ss_tm_image_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t byte_order_mark;
+    uint64_t transition_size;
+    uint64_t word_size;
+    uint64_t file_size;
+
+    uint64_t transitions_offset;
+    uint64_t transitions_end;
+    uint64_t index_offset;
+    // Number of slots in the index, a power of two.
+    uint64_t index_size;
+
+    // 0 if the image has no simulation snapshot, in which case the tape
+    // fields are all 0.
+    uint64_t has_tape;
+    uint64_t tape_offset;
+    uint64_t tape_size;
+    uint64_t tape_head;
+    uint64_t state;
+    uint64_t steps;
+};
+
+struct ss_tm_image {
+    const void *data;
+    size_t data_size;
+    const struct ss_tm_image_header *header;
+    // Initialized machine whose transitions and index point into the
+    // mapping. Simulate on it directly, or borrow it with
+    // ss_tm_init_borrow to simulate on several threads.
+    struct ss_tm machine;
+};
+
+// Writes machine's table to path, along with its current simulation if
+// include_tape is true and a simulation has been started. The image is
+// written beside path and renamed over it, so processes that have the old
+// image mapped keep a consistent view of it.
+    enum ss_tm_err
+ss_tm_image_write(
+    const struct ss_tm *machine,
+    bool include_tape,
+    const char *path);
+
+// Maps the image at path. Fails with SS_TM_ERR_BAD_FILE_FORMAT if it isn't
+// an image of this version written by a compatible host.
+    enum ss_tm_err
+ss_tm_image_open(
+    struct ss_tm_image *self,
+    const char *path);
+
+// Starts a simulation on tm, which must be self->machine or a machine
+// borrowing it, from the image's snapshot (see ss_tm_simulation_resume). The
+// tape is copied, since the mapping is read-only, and counts against tm's
+// space limits. Fails with SS_TM_ERR_OUT_OF_RANGE if the image has no
+// snapshot.
+    enum ss_tm_err
+ss_tm_image_simulation_begin(
+    const struct ss_tm_image *self,
+    struct ss_tm *tm);
+
+// Destroys self->machine and unmaps the image. Machines borrowing
+// self->machine must be destroyed first.
+    enum ss_tm_err
+ss_tm_image_close(
+    struct ss_tm_image *self);
+
+#endif // #ifndef ss_tm_image_h
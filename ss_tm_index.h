@@ -0,0 +1,44 @@
+#ifndef ss_tm_index_h
+#define ss_tm_index_h
+
+#include <stddef.h>
+#include <inttypes.h>
+
+// Hashing for the open-addressed transition indexes of single-tape (ss_tm.c)
+// and multi-tape (ss_tm_multi.c) machines, and for the tape shapes of
+// ss_tm_accel.c. Index sizes are powers of two, so a slot is the hash masked
+// by size - 1.
+
+    static inline size_t
+ss_tm_index_slot(
+    uint64_t state,
+    uint64_t in_char,
+    size_t index_mask) {
+
+    uint64_t h = state * 0x9E3779B97F4A7C15ull ^
+        (in_char + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+    return (size_t)h & index_mask;
+}
+
+// The slot for a key of several characters, one per tape. With one
+// character, the same as ss_tm_index_slot.
+    static inline size_t
+ss_tm_index_slot_multi(
+    uint64_t state,
+    const uint64_t *in_chars,
+    size_t num_chars,
+    size_t index_mask) {
+
+    uint64_t h = state * 0x9E3779B97F4A7C15ull ^
+        (in_chars[0] + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+    size_t i;
+    for(i = 1; i < num_chars; i++) {
+        h = (h ^ (h >> 29)) * 0x94D049BB133111EBull;
+        h ^= (in_chars[i] + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+    }
+    h ^= h >> 31;
+    return (size_t)h & index_mask;
+}
+
+#endif // #ifndef ss_tm_index_h
@@ -0,0 +1,220 @@
+#include "ss_tm_monitor.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+    enum ss_tm_err
+ss_tm_monitor_init(
+    struct ss_tm_monitor *self,
+    size_t num_slots,
+    uint64_t publish_interval) {
+
+    // Each slot gets its own cache line, so publishers don't contend.
+    self->slots = (struct ss_tm_monitor_slot *)aligned_alloc(
+        sizeof(struct ss_tm_monitor_slot),
+        (num_slots ? num_slots : 1) * sizeof(struct ss_tm_monitor_slot));
+    if(!self->slots)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    memset(self->slots, 0, num_slots * sizeof(struct ss_tm_monitor_slot));
+    self->num_slots = num_slots;
+    self->publish_interval = publish_interval ? publish_interval : 1;
+    self->reporter_running = false;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_monitor_destroy(
+    struct ss_tm_monitor *self) {
+
+    ss_tm_monitor_stop_reporter(self);
+    free(self->slots);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Writes the fields of slot s as one seqlock update.
+    static void
+ss_tm_monitor_write(
+    struct ss_tm_monitor_slot *s,
+    bool active,
+    uint64_t id,
+    const struct ss_tm *tm) {
+
+    // Only this thread writes the sequence, so it can't change under us.
+    uint64_t sequence = __atomic_load_n(&s->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->sequence, sequence + 1, __ATOMIC_RELAXED);
+    // Keeps the field stores below from becoming visible before the odd
+    // sequence number.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->active, active, __ATOMIC_RELAXED);
+    if(active) {
+        __atomic_store_n(&s->id, id, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->steps, tm->steps, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->state, tm->state, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->head, tm->tape_head, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->tape_size, tm->tape_size, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->tape_used, tm->tape_used, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&s->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+    enum ss_tm_err
+ss_tm_monitor_publish(
+    struct ss_tm_monitor *self,
+    size_t slot,
+    uint64_t id,
+    const struct ss_tm *tm) {
+
+    if(slot >= self->num_slots)
+        return SS_TM_ERR_OUT_OF_RANGE;
+    if(!tm->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    ss_tm_monitor_write(&self->slots[slot], true, id, tm);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_monitor_clear(
+    struct ss_tm_monitor *self,
+    size_t slot) {
+
+    if(slot >= self->num_slots)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    ss_tm_monitor_write(&self->slots[slot], false, 0, NULL);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_monitor_step_multiple(
+    struct ss_tm_monitor *self,
+    size_t slot,
+    uint64_t id,
+    struct ss_tm *tm,
+    uint64_t num_steps) {
+
+    if(slot >= self->num_slots)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    // The steps themselves run in ss_tm_simulation_step_multiple's loop, so
+    // monitoring only costs one publish per publish_interval steps.
+    uint64_t remaining = num_steps;
+    while(true) {
+        uint64_t chunk = remaining < self->publish_interval ?
+            remaining : self->publish_interval;
+        enum ss_tm_err e = ss_tm_simulation_step_multiple(tm, chunk);
+        remaining -= chunk;
+        if(tm->simulation_started)
+            ss_tm_monitor_write(&self->slots[slot], true, id, tm);
+        if(e != SS_TM_ERR_NO_ERROR || remaining == 0)
+            return e;
+    }
+}
+
+    enum ss_tm_err
+ss_tm_monitor_sample(
+    const struct ss_tm_monitor *self,
+    size_t slot,
+    struct ss_tm_monitor_sample *out_sample) {
+
+    if(slot >= self->num_slots)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    const struct ss_tm_monitor_slot *s = &self->slots[slot];
+    uint64_t before;
+    uint64_t after;
+    do {
+        before = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+        out_sample->active = __atomic_load_n(&s->active, __ATOMIC_RELAXED);
+        out_sample->id = __atomic_load_n(&s->id, __ATOMIC_RELAXED);
+        out_sample->steps = __atomic_load_n(&s->steps, __ATOMIC_RELAXED);
+        out_sample->state = __atomic_load_n(&s->state, __ATOMIC_RELAXED);
+        out_sample->head = __atomic_load_n(&s->head, __ATOMIC_RELAXED);
+        out_sample->tape_size = __atomic_load_n(&s->tape_size, __ATOMIC_RELAXED);
+        out_sample->tape_used = __atomic_load_n(&s->tape_used, __ATOMIC_RELAXED);
+        // Keeps the field loads above from happening after the second load
+        // of the sequence number.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&s->sequence, __ATOMIC_RELAXED);
+    } while((before & 1) || before != after);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static void *
+ss_tm_monitor_reporter(
+    void *arg) {
+
+    struct ss_tm_monitor *self = (struct ss_tm_monitor *)arg;
+    pthread_mutex_lock(&self->reporter_lock);
+    while(!self->reporter_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += self->reporter_period_ms / 1000;
+        deadline.tv_nsec += (self->reporter_period_ms % 1000) * 1000000;
+        if(deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while(!self->reporter_stop &&
+            pthread_cond_timedwait(&self->reporter_cond, &self->reporter_lock, &deadline) == 0);
+        if(self->reporter_stop)
+            break;
+
+        size_t i;
+        for(i = 0; i < self->num_slots; i++) {
+            struct ss_tm_monitor_sample sample;
+            ss_tm_monitor_sample(self, i, &sample);
+            if(!sample.active)
+                continue;
+            fprintf(self->reporter_f, "slot %zu: id %" PRIu64 ", step %" PRIu64
+                ", state %" PRIu64 ", head %zu, tape %zu/%zu cells used\n",
+                i, sample.id, sample.steps, sample.state, sample.head,
+                sample.tape_used, sample.tape_size);
+        }
+        fflush(self->reporter_f);
+    }
+    pthread_mutex_unlock(&self->reporter_lock);
+    return NULL;
+}
+
+    enum ss_tm_err
+ss_tm_monitor_start_reporter(
+    struct ss_tm_monitor *self,
+    FILE *f,
+    uint64_t period_ms) {
+
+    if(self->reporter_running)
+        return SS_TM_ERR_NO_ERROR;
+
+    self->reporter_f = f;
+    self->reporter_period_ms = period_ms;
+    self->reporter_stop = false;
+    pthread_mutex_init(&self->reporter_lock, NULL);
+    pthread_cond_init(&self->reporter_cond, NULL);
+    if(pthread_create(&self->reporter, NULL, ss_tm_monitor_reporter, self)) {
+        pthread_cond_destroy(&self->reporter_cond);
+        pthread_mutex_destroy(&self->reporter_lock);
+        return SS_TM_ERR_THREAD_CREATE_FAILED;
+    }
+    self->reporter_running = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_monitor_stop_reporter(
+    struct ss_tm_monitor *self) {
+
+    if(!self->reporter_running)
+        return SS_TM_ERR_NO_ERROR;
+
+    pthread_mutex_lock(&self->reporter_lock);
+    self->reporter_stop = true;
+    pthread_cond_signal(&self->reporter_cond);
+    pthread_mutex_unlock(&self->reporter_lock);
+    pthread_join(self->reporter, NULL);
+    pthread_cond_destroy(&self->reporter_cond);
+    pthread_mutex_destroy(&self->reporter_lock);
+    self->reporter_running = false;
+    return SS_TM_ERR_NO_ERROR;
+}
@@ -0,0 +1,118 @@
+#ifndef ss_tm_monitor_h
+#define ss_tm_monitor_h
+
+#include "ss_tm.h"
+
+#include <pthread.h>
+
+// Live progress of simulations running on other threads. Each running
+// simulation owns a slot and publishes its step count, state, head and tape
+// extent to it every so often; any thread can sample any slot at any time.
+//
+// A slot is a seqlock: the one thread writing it makes the sequence number
+// odd, stores the fields, and makes it even again, and a reader retries
+// until it sees the same even number before and after reading. Neither side
+// takes a lock, so a slow or stalled reader never holds up the simulation,
+// and a publish costs a handful of stores to a cache line no other writer
+// touches.
+
+struct ss_tm_monitor_sample {
+    // false if nothing is running in the slot, in which case the rest is
+    // meaningless.
+    bool active;
+    // Chosen by the publisher, to tell which simulation is in the slot.
+    uint64_t id;
+    uint64_t steps;
+    uint64_t state;
+    size_t head;
+    size_t tape_size;
+    size_t tape_used;
+};
+
+struct ss_tm_monitor_slot {
+    // Odd while a publish is under way.
+    uint64_t sequence;
+    uint64_t active;
+    uint64_t id;
+    uint64_t steps;
+    uint64_t state;
+    uint64_t head;
+    uint64_t tape_size;
+    uint64_t tape_used;
+} __attribute__((aligned(64)));
+
+struct ss_tm_monitor {
+    struct ss_tm_monitor_slot *slots;
+    size_t num_slots;
+    // ss_tm_monitor_step_multiple publishes after every this many steps.
+    uint64_t publish_interval;
+
+    // For the reporter thread.
+    bool reporter_running;
+    pthread_t reporter;
+    pthread_mutex_t reporter_lock;
+    pthread_cond_t reporter_cond;
+    bool reporter_stop;
+    FILE *reporter_f;
+    uint64_t reporter_period_ms;
+};
+
+// All slots start out inactive.
+    enum ss_tm_err
+ss_tm_monitor_init(
+    struct ss_tm_monitor *self,
+    size_t num_slots,
+    uint64_t publish_interval);
+
+// Stops the reporter, if it's running. Nothing may be publishing.
+    enum ss_tm_err
+ss_tm_monitor_destroy(
+    struct ss_tm_monitor *self);
+
+// Publishes tm's configuration to slot, which must only ever be published to
+// by one thread at a time. tm must have a started simulation.
+    enum ss_tm_err
+ss_tm_monitor_publish(
+    struct ss_tm_monitor *self,
+    size_t slot,
+    uint64_t id,
+    const struct ss_tm *tm);
+
+// Marks slot inactive, for when its simulation is over.
+    enum ss_tm_err
+ss_tm_monitor_clear(
+    struct ss_tm_monitor *self,
+    size_t slot);
+
+// Like ss_tm_simulation_step_multiple, publishing to slot every
+// publish_interval steps and once more at the end, however the steps end.
+    enum ss_tm_err
+ss_tm_monitor_step_multiple(
+    struct ss_tm_monitor *self,
+    size_t slot,
+    uint64_t id,
+    struct ss_tm *tm,
+    uint64_t num_steps);
+
+// Reads a consistent copy of slot's last publish. May be called from any
+// thread, concurrently with publishing.
+    enum ss_tm_err
+ss_tm_monitor_sample(
+    const struct ss_tm_monitor *self,
+    size_t slot,
+    struct ss_tm_monitor_sample *out_sample);
+
+// Starts a thread that writes a line to f for every active slot every
+// period_ms milliseconds, until ss_tm_monitor_stop_reporter. f stays owned
+// by the caller.
+    enum ss_tm_err
+ss_tm_monitor_start_reporter(
+    struct ss_tm_monitor *self,
+    FILE *f,
+    uint64_t period_ms);
+
+    enum ss_tm_err
+ss_tm_monitor_stop_reporter(
+    struct ss_tm_monitor *self);
+
+#endif // #ifndef ss_tm_monitor_h
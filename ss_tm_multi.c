@@ -0,0 +1,467 @@
+#include "ss_tm_multi.h"
+#include "ss_tm_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Word offsets within a record.
+#define SS_TM_MULTI_IN_STATE(self) 0
+#define SS_TM_MULTI_IN_CHARS(self) 1
+#define SS_TM_MULTI_OUT_STATE(self) (1 + (self)->num_tapes)
+#define SS_TM_MULTI_OUT_CHARS(self) (2 + (self)->num_tapes)
+#define SS_TM_MULTI_MOVES(self) (2 + 2 * (self)->num_tapes)
+
+    static inline uint64_t *
+ss_tm_multi_record(
+    const struct ss_tm_multi *self,
+    size_t i) {
+
+    return self->records + i * self->record_size;
+}
+
+// Returns NULL if no transition's key is (state, in_chars).
+    static inline const uint64_t *
+ss_tm_multi_find_transition(
+    const struct ss_tm_multi *self,
+    uint64_t state,
+    const uint64_t *in_chars) {
+
+    size_t slot = ss_tm_index_slot_multi(state, in_chars, self->num_tapes, self->index_mask);
+    size_t entry;
+    while((entry = self->index[slot]) != 0) {
+        const uint64_t *record = ss_tm_multi_record(self, entry - 1);
+        if(record[SS_TM_MULTI_IN_STATE(self)] == state &&
+            memcmp(record + SS_TM_MULTI_IN_CHARS(self), in_chars,
+                self->num_tapes * sizeof(uint64_t)) == 0) {
+
+            return record;
+        }
+        slot = (slot + 1) & self->index_mask;
+    }
+    return NULL;
+}
+
+// Adds transition i to the index, which must have room for it.
+    static void
+ss_tm_multi_index_insert(
+    struct ss_tm_multi *self,
+    size_t i) {
+
+    const uint64_t *record = ss_tm_multi_record(self, i);
+    size_t slot = ss_tm_index_slot_multi(
+        record[SS_TM_MULTI_IN_STATE(self)],
+        record + SS_TM_MULTI_IN_CHARS(self),
+        self->num_tapes,
+        self->index_mask);
+    while(self->index[slot] != 0)
+        slot = (slot + 1) & self->index_mask;
+    self->index[slot] = i + 1;
+}
+
+// Cells in use over all the tapes, which is what max_tape_cells caps.
+    static size_t
+ss_tm_multi_tape_cells(
+    const struct ss_tm_multi *self) {
+
+    size_t cells = 0;
+    size_t i;
+    for(i = 0; i < self->num_tapes; i++)
+        cells += self->tapes[i].size;
+    return cells;
+}
+
+// Cells allocated over all the tapes, which is what the budget is charged for.
+    static size_t
+ss_tm_multi_tape_capacity(
+    const struct ss_tm_multi *self) {
+
+    size_t cells = 0;
+    size_t i;
+    for(i = 0; i < self->num_tapes; i++)
+        cells += self->tapes[i].capacity;
+    return cells;
+}
+
+    enum ss_tm_err
+ss_tm_multi_init_begin(
+    struct ss_tm_multi *self,
+    size_t num_tapes) {
+
+    if(num_tapes == 0 || num_tapes > SS_TM_MULTI_MAX_TAPES)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    self->init = false;
+    self->num_tapes = num_tapes;
+    self->record_size = 2 * num_tapes + 3;
+    self->records = (uint64_t *)malloc(sizeof(uint64_t) * self->record_size * 16);
+    self->index = (size_t *)calloc(32, sizeof(size_t));
+    if(!self->records || !self->index) {
+        free(self->records);
+        free(self->index);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->transitions_end = 0;
+    self->transitions_size = 16;
+    self->index_mask = 31;
+
+    self->max_tape_cells = 0;
+    self->budget = NULL;
+
+    self->simulation_started = false;
+    size_t i;
+    for(i = 0; i < num_tapes; i++) {
+        self->tapes[i].cells = NULL;
+        self->tapes[i].size = 0;
+        self->tapes[i].capacity = 0;
+        self->tapes[i].head = 0;
+        self->tapes[i].used = 0;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_add_transition(
+    struct ss_tm_multi *self,
+    const struct ss_tm_multi_transition *to_add) {
+
+    if(ss_tm_multi_find_transition(self, to_add->in_state, to_add->in_chars))
+        return SS_TM_ERR_ADDING_ALREADY_EXISTING_STATE;
+
+    if(self->init) {
+        return SS_TM_ERR_MACHINE_ALREADY_INITIALIZED;
+    }
+
+    uint64_t moves = 0;
+    size_t i;
+    for(i = 0; i < self->num_tapes; i++) {
+        if((unsigned)to_add->moves[i] > SS_TM_MULTI_STAY)
+            return SS_TM_ERR_OUT_OF_RANGE;
+        moves |= (uint64_t)to_add->moves[i] << (2 * i);
+    }
+
+    if(self->transitions_size == self->transitions_end) {
+        uint64_t *records = (uint64_t *)realloc(
+            self->records,
+            sizeof(uint64_t) * self->record_size * self->transitions_size * 2);
+        if(!records)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        self->records = records;
+        self->transitions_size *= 2;
+    }
+
+    // Keep the load factor at or below 1/2.
+    if((self->transitions_end + 1) * 2 > self->index_mask + 1) {
+        size_t index_size = (self->index_mask + 1) * 2;
+        size_t *index = (size_t *)calloc(index_size, sizeof(size_t));
+        if(!index)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        free(self->index);
+        self->index = index;
+        self->index_mask = index_size - 1;
+        for(i = 0; i < self->transitions_end; i++)
+            ss_tm_multi_index_insert(self, i);
+    }
+
+    uint64_t *record = ss_tm_multi_record(self, self->transitions_end);
+    record[SS_TM_MULTI_IN_STATE(self)] = to_add->in_state;
+    memcpy(record + SS_TM_MULTI_IN_CHARS(self), to_add->in_chars,
+        self->num_tapes * sizeof(uint64_t));
+    record[SS_TM_MULTI_OUT_STATE(self)] = to_add->out_state;
+    memcpy(record + SS_TM_MULTI_OUT_CHARS(self), to_add->out_chars,
+        self->num_tapes * sizeof(uint64_t));
+    record[SS_TM_MULTI_MOVES(self)] = moves;
+    ss_tm_multi_index_insert(self, self->transitions_end);
+    self->transitions_end++;
+
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_init_end(
+    struct ss_tm_multi *self) {
+
+    if(self->init) {
+        return SS_TM_ERR_MACHINE_ALREADY_INITIALIZED;
+    }
+    self->init = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_destroy(
+    struct ss_tm_multi *self) {
+
+    free(self->records);
+    free(self->index);
+    ss_tm_budget_release(self->budget, ss_tm_multi_tape_capacity(self) * sizeof(uint64_t));
+    size_t i;
+    for(i = 0; i < self->num_tapes; i++)
+        free(self->tapes[i].cells);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_set_space_limits(
+    struct ss_tm_multi *self,
+    size_t max_tape_cells,
+    struct ss_tm_budget *budget) {
+
+    if(budget != self->budget) {
+        size_t bytes = ss_tm_multi_tape_capacity(self) * sizeof(uint64_t);
+        enum ss_tm_err e = ss_tm_budget_charge(budget, bytes);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+        ss_tm_budget_release(self->budget, bytes);
+    }
+    self->max_tape_cells = max_tape_cells;
+    self->budget = budget;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Makes tape hold input_size cells of input (at least one cell), followed by
+// blanks, reusing its buffer if it's big enough.
+    static enum ss_tm_err
+ss_tm_multi_tape_reset(
+    struct ss_tm_multi *self,
+    struct ss_tm_multi_tape *tape,
+    const uint64_t *input,
+    size_t input_size) {
+
+    size_t size = input_size ? input_size : 1;
+    if(tape->cells && size <= tape->capacity) {
+        if(tape->used > input_size)
+            memset(tape->cells + input_size, 0x00, (tape->used - input_size) * sizeof(uint64_t));
+    } else {
+        ss_tm_budget_release(self->budget, tape->capacity * sizeof(uint64_t));
+        free(tape->cells);
+        tape->cells = NULL;
+        tape->size = 0;
+        tape->capacity = 0;
+        tape->used = 0;
+        enum ss_tm_err e = ss_tm_budget_charge(self->budget, size * sizeof(uint64_t));
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+        tape->cells = (uint64_t *)calloc(size, sizeof(uint64_t));
+        if(!tape->cells) {
+            ss_tm_budget_release(self->budget, size * sizeof(uint64_t));
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        tape->capacity = size;
+    }
+    if(input_size)
+        memcpy(tape->cells, input, input_size * sizeof(uint64_t));
+    tape->size = size;
+    tape->used = size;
+    tape->head = 0;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_simulation_begin(
+    struct ss_tm_multi *self,
+    const uint64_t *input_string,
+    size_t input_string_size) {
+
+    if(!self->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    enum ss_tm_err e = ss_tm_validate_input(input_string, input_string_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    // Every tape needs a cell to read, even for the empty string.
+    size_t tape_cells = (input_string_size ? input_string_size : 1) + self->num_tapes - 1;
+    if(self->max_tape_cells && tape_cells > self->max_tape_cells)
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+
+    self->simulation_started = false;
+    size_t i;
+    for(i = 0; i < self->num_tapes; i++) {
+        e = ss_tm_multi_tape_reset(
+            self,
+            &self->tapes[i],
+            i == 0 ? input_string : NULL,
+            i == 0 ? input_string_size : 0);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+    self->state = SS_TM_INITIAL_STATE;
+    self->steps = 0;
+    self->simulation_started = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Doubles tape, whose head is about to move off the end of it, or grows it as
+// far as max_tape_cells allows. If it can't, the tape is left as it was.
+    static enum ss_tm_err
+ss_tm_multi_tape_grow(
+    struct ss_tm_multi *self,
+    struct ss_tm_multi_tape *tape) {
+
+    size_t new_size = 2 * tape->size;
+    if(self->max_tape_cells) {
+        size_t other_cells = ss_tm_multi_tape_cells(self) - tape->size;
+        size_t room = self->max_tape_cells > other_cells ?
+            self->max_tape_cells - other_cells : 0;
+        if(new_size > room)
+            new_size = room;
+    }
+    if(new_size <= tape->size)
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+
+    if(new_size <= tape->capacity) {
+        // Already allocated, and blank, by an earlier simulation.
+        tape->size = new_size;
+        return SS_TM_ERR_NO_ERROR;
+    }
+    size_t new_bytes = (new_size - tape->capacity) * sizeof(uint64_t);
+    enum ss_tm_err e = ss_tm_budget_charge(self->budget, new_bytes);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    uint64_t *cells = (uint64_t *)realloc(tape->cells, new_size * sizeof(uint64_t));
+    if(!cells) {
+        ss_tm_budget_release(self->budget, new_bytes);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    memset(cells + tape->capacity, 0x00, new_bytes);
+    tape->cells = cells;
+    tape->size = new_size;
+    tape->capacity = new_size;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_simulation_step(
+    struct ss_tm_multi *self) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    if(self->state == SS_TM_ACCEPT_STATE ||
+        self->state == SS_TM_REJECT_STATE) {
+
+        return SS_TM_ERR_STEP_ON_HALTED_MACHINE;
+    }
+
+    size_t num_tapes = self->num_tapes;
+    // There's always at least one tape.
+    uint64_t in_chars[SS_TM_MULTI_MAX_TAPES];
+    in_chars[0] = self->tapes[0].cells[self->tapes[0].head];
+    size_t i;
+    for(i = 1; i < num_tapes; i++)
+        in_chars[i] = self->tapes[i].cells[self->tapes[i].head];
+
+    const uint64_t *record = ss_tm_multi_find_transition(self, self->state, in_chars);
+    if(!record) {
+        self->state = SS_TM_REJECT_STATE;
+        self->steps++;
+        self->last_transition = self->transitions_end;
+        return SS_TM_ERR_NO_ERROR;
+    }
+
+    uint64_t moves = record[SS_TM_MULTI_MOVES(self)];
+    for(i = 0; i < num_tapes; i++) {
+        if(((moves >> (2 * i)) & 3) == SS_TM_MULTI_LEFT && self->tapes[i].head == 0)
+            return SS_TM_ERR_HEAD_FELL_OFF_TAPE;
+    }
+
+    // Grow every tape a head is about to move off before touching any of
+    // them, so a failed step leaves the configuration as it was.  Growing only
+    // adds blanks, so tapes grown before a later failure are still fine.
+    for(i = 0; i < num_tapes; i++) {
+        struct ss_tm_multi_tape *tape = &self->tapes[i];
+        if(((moves >> (2 * i)) & 3) == SS_TM_MULTI_RIGHT && tape->head + 1 == tape->size) {
+            enum ss_tm_err e = ss_tm_multi_tape_grow(self, tape);
+            if(e != SS_TM_ERR_NO_ERROR)
+                return e;
+        }
+    }
+
+    const uint64_t *out_chars = record + SS_TM_MULTI_OUT_CHARS(self);
+    for(i = 0; i < num_tapes; i++) {
+        struct ss_tm_multi_tape *tape = &self->tapes[i];
+        tape->cells[tape->head] = out_chars[i];
+        switch((moves >> (2 * i)) & 3) {
+            case SS_TM_MULTI_LEFT:
+                tape->head--;
+                break;
+            case SS_TM_MULTI_RIGHT:
+                tape->head++;
+                tape->used += tape->head == tape->used;
+                break;
+        }
+    }
+    self->state = record[SS_TM_MULTI_OUT_STATE(self)];
+    self->steps++;
+    self->last_transition = (record - self->records) / self->record_size;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_simulation_step_multiple(
+    struct ss_tm_multi *self,
+    uint64_t num_steps) {
+
+    uint64_t i;
+    for(i = 0; i < num_steps; i++) {
+        enum ss_tm_err e = ss_tm_multi_simulation_step(self);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_peek_tape_all(
+    struct ss_tm_multi *self,
+    size_t tape,
+    const uint64_t **out_cells,
+    size_t *out_num_cells) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+    if(tape >= self->num_tapes)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    *out_cells = self->tapes[tape].cells;
+    *out_num_cells = self->tapes[tape].size;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_peek_head_pos(
+    struct ss_tm_multi *self,
+    size_t tape,
+    size_t *out_head_pos) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+    if(tape >= self->num_tapes)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    *out_head_pos = self->tapes[tape].head;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_peek_state(
+    struct ss_tm_multi *self,
+    uint64_t *out_state) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    *out_state = self->state;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_multi_peek_steps(
+    struct ss_tm_multi *self,
+    uint64_t *out_steps) {
+
+    if(!self->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    *out_steps = self->steps;
+    return SS_TM_ERR_NO_ERROR;
+}
@@ -0,0 +1,153 @@
+#ifndef ss_tm_multi_h
+#define ss_tm_multi_h
+
+#include "ss_tm.h"
+
+// Machines with several tapes, each with its own head. A transition matches
+// the state and the character under every head, writes a character to every
+// tape, and moves every head left, right, or not at all. The input goes on
+// tape 0; the others start blank. As with single-tape machines, tapes are
+// one-way and grow to the right as needed, and a missing transition rejects.
+//
+// Transitions are looked up in the same kind of open-addressed index as
+// single-tape machines use (see ss_tm_index.h), hashed over the state and
+// all the characters read. Each tape is its own contiguous buffer.
+//
+// Space limits work as for single-tape machines (see ss_tm_set_space_limits),
+// except that the cap counts the cells of every tape together.
+
+#define SS_TM_MULTI_MAX_TAPES 16
+
+enum ss_tm_multi_move {
+    SS_TM_MULTI_LEFT,
+    SS_TM_MULTI_RIGHT,
+    SS_TM_MULTI_STAY
+};
+
+struct ss_tm_multi_transition {
+    uint64_t in_state;
+    // One per tape; only the first num_tapes are used.
+    uint64_t in_chars[SS_TM_MULTI_MAX_TAPES];
+    uint64_t out_state;
+    uint64_t out_chars[SS_TM_MULTI_MAX_TAPES];
+    enum ss_tm_multi_move moves[SS_TM_MULTI_MAX_TAPES];
+};
+
+struct ss_tm_multi_tape {
+    uint64_t *cells;
+    // Cells in the simulation so far; see ss_tm's tape_size.
+    size_t size;
+    // Cells allocated, kept between simulations; cells past size are blank.
+    size_t capacity;
+    size_t head;
+    // Cells from used on are blank; see ss_tm's tape_used.
+    size_t used;
+};
+
+struct ss_tm_multi {
+    bool init;
+    size_t num_tapes;
+    // Transition i is the record_size words at records + i * record_size:
+    // in_state, num_tapes in_chars, out_state, num_tapes out_chars, and the
+    // moves packed two bits per tape, so a step touches one contiguous record.
+    uint64_t *records;
+    size_t record_size;
+    size_t transitions_end;
+    size_t transitions_size;
+    // Open-addressed hash of the key words of a record -> 1 + its index.
+    // 0 marks an empty slot.
+    size_t *index;
+    size_t index_mask;
+    // Most cells all the tapes together may have; 0 for no limit. See
+    // ss_tm_multi_set_space_limits.
+    size_t max_tape_cells;
+    // Charged for every tape's capacity cells, if not NULL.
+    struct ss_tm_budget *budget;
+
+    // For simulations
+    bool simulation_started;
+    struct ss_tm_multi_tape tapes[SS_TM_MULTI_MAX_TAPES];
+    uint64_t state;
+    uint64_t steps;
+    // Index of the transition the last step took, or transitions_end if the
+    // last step rejected for want of one.
+    size_t last_transition;
+};
+
+// Fails with SS_TM_ERR_OUT_OF_RANGE unless 1 <= num_tapes <=
+// SS_TM_MULTI_MAX_TAPES.
+    enum ss_tm_err
+ss_tm_multi_init_begin(
+    struct ss_tm_multi *self,
+    size_t num_tapes);
+
+// Fails with SS_TM_ERR_OUT_OF_RANGE if a move isn't one of enum
+// ss_tm_multi_move.
+    enum ss_tm_err
+ss_tm_multi_add_transition(
+    struct ss_tm_multi *self,
+    const struct ss_tm_multi_transition *to_add);
+
+    enum ss_tm_err
+ss_tm_multi_init_end(
+    struct ss_tm_multi *self);
+
+    enum ss_tm_err
+ss_tm_multi_destroy(
+    struct ss_tm_multi *self);
+
+// Caps the tapes at max_tape_cells cells between them (0 for no cap) and
+// charges them to budget (NULL for none) from now on, like
+// ss_tm_set_space_limits. A step that needs a tape to grow past either fails
+// with SS_TM_ERR_MEMORY_LIMIT_REACHED, and so does a simulation_begin whose
+// input and one cell on every other tape don't fit under the cap.
+    enum ss_tm_err
+ss_tm_multi_set_space_limits(
+    struct ss_tm_multi *self,
+    size_t max_tape_cells,
+    struct ss_tm_budget *budget);
+
+// Puts input_string on tape 0, blanks the other tapes, and puts every head on
+// its tape's first cell. Tape buffers are kept between simulations.
+    enum ss_tm_err
+ss_tm_multi_simulation_begin(
+    struct ss_tm_multi *self,
+    const uint64_t *input_string,
+    size_t input_string_size);
+
+// If any head would move off the left end of its tape, fails with
+// SS_TM_ERR_HEAD_FELL_OFF_TAPE and leaves the configuration unchanged. So
+// does a failure to grow a tape.
+    enum ss_tm_err
+ss_tm_multi_simulation_step(
+    struct ss_tm_multi *self);
+
+    enum ss_tm_err
+ss_tm_multi_simulation_step_multiple(
+    struct ss_tm_multi *self,
+    uint64_t num_steps);
+
+    enum ss_tm_err
+ss_tm_multi_peek_tape_all(
+    struct ss_tm_multi *self,
+    size_t tape,
+    const uint64_t **out_cells,
+    size_t *out_num_cells);
+
+    enum ss_tm_err
+ss_tm_multi_peek_head_pos(
+    struct ss_tm_multi *self,
+    size_t tape,
+    size_t *out_head_pos);
+
+    enum ss_tm_err
+ss_tm_multi_peek_state(
+    struct ss_tm_multi *self,
+    uint64_t *out_state);
+
+    enum ss_tm_err
+ss_tm_multi_peek_steps(
+    struct ss_tm_multi *self,
+    uint64_t *out_steps);
+
+#endif // #ifndef ss_tm_multi_h
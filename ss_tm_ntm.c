@@ -0,0 +1,636 @@
+#include "ss_tm_ntm.h"
+#include "ss_tm_hash.h"
+#include "ss_tm_view.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// The visited set is split into this many stripes, each with its own lock
+// and its own open-addressed table.
+#define SS_TM_NTM_NUM_STRIPES 64
+#define SS_TM_NTM_STRIPE_SHIFT 58
+#define SS_TM_NTM_INITIAL_STRIPE_SIZE 64
+
+struct ss_tm_ntm_config {
+    uint64_t state;
+    size_t head;
+    uint64_t depth;
+    uint64_t hash;
+    // SS_TM_HASH_BASE to the power head, to update hash with.
+    uint64_t head_power;
+    size_t tape_size;
+    uint64_t tape[];
+};
+
+struct ss_tm_ntm_key {
+    uint64_t state;
+    uint64_t head;
+    uint64_t hash;
+    // The tape up to its last non-blank cell. Keys in the visited set own a
+    // copy of it (or point at ss_tm_ntm_no_cells), which is compared whenever
+    // the words above match, since cells congruent modulo the hash's modulus
+    // hash alike. NULL marks an empty slot.
+    const uint64_t *tape;
+    size_t tape_used;
+};
+
+// The tape of keys whose tape is all blank.
+static const uint64_t ss_tm_ntm_no_cells[1];
+
+struct ss_tm_ntm_stripe {
+    pthread_mutex_t lock;
+    struct ss_tm_ntm_key *keys;
+    size_t size;
+    size_t count;
+};
+
+struct ss_tm_ntm_entry {
+    double priority;
+    // Breaks ties first in, first out.
+    uint64_t seq;
+    struct ss_tm_ntm_config *config;
+};
+
+struct ss_tm_ntm_shared {
+    const struct ss_tm *machine;
+    const struct ss_tm_ntm_options *options;
+    // SS_TM_HASH_BASE's inverse, to update head_power on left moves.
+    uint64_t base_inverse;
+
+    struct ss_tm_ntm_stripe stripes[SS_TM_NTM_NUM_STRIPES];
+
+    // Updated atomically.
+    size_t memory_used;
+    size_t peak_memory;
+    uint64_t num_visited;
+
+    // Guards the queue and everything below it.
+    pthread_mutex_t lock;
+    // Signalled when the queue gains an entry or the exploration ends.
+    pthread_cond_t cond;
+    // Binary heap on (priority, seq).
+    struct ss_tm_ntm_entry *heap;
+    size_t heap_end;
+    size_t heap_size;
+    uint64_t next_seq;
+    // Workers expanding a configuration, which may yet queue more.
+    size_t num_busy;
+    bool done;
+
+    bool accepted;
+    uint64_t accept_depth;
+    bool cut_off;
+    bool space_limit;
+    enum ss_tm_err err;
+    uint64_t num_expanded;
+    uint64_t max_depth_reached;
+};
+
+// Accounts for bytes more memory. Returns false, accounting for nothing, if
+// that would exceed the limit.
+    static bool
+ss_tm_ntm_reserve(
+    struct ss_tm_ntm_shared *shared,
+    size_t bytes) {
+
+    size_t used = __atomic_add_fetch(&shared->memory_used, bytes, __ATOMIC_RELAXED);
+    if(shared->options->memory_limit && used > shared->options->memory_limit) {
+        __atomic_sub_fetch(&shared->memory_used, bytes, __ATOMIC_RELAXED);
+        return false;
+    }
+    size_t peak = __atomic_load_n(&shared->peak_memory, __ATOMIC_RELAXED);
+    while(used > peak &&
+        !__atomic_compare_exchange_n(&shared->peak_memory, &peak, used, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return true;
+}
+
+    static void
+ss_tm_ntm_release(
+    struct ss_tm_ntm_shared *shared,
+    size_t bytes) {
+
+    __atomic_sub_fetch(&shared->memory_used, bytes, __ATOMIC_RELAXED);
+}
+
+// Ends the exploration. Call with shared->lock held.
+    static void
+ss_tm_ntm_finish_locked(
+    struct ss_tm_ntm_shared *shared) {
+
+    shared->done = true;
+    pthread_cond_broadcast(&shared->cond);
+}
+
+    static void
+ss_tm_ntm_fail(
+    struct ss_tm_ntm_shared *shared,
+    enum ss_tm_err e) {
+
+    pthread_mutex_lock(&shared->lock);
+    if(e == SS_TM_ERR_MEMORY_LIMIT_REACHED)
+        shared->space_limit = true;
+    else if(shared->err == SS_TM_ERR_NO_ERROR)
+        shared->err = e;
+    ss_tm_ntm_finish_locked(shared);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+    static size_t
+ss_tm_ntm_key_slot(
+    const struct ss_tm_ntm_key *key) {
+
+    uint64_t h = key->state * 0x9E3779B97F4A7C15ull ^
+        (key->head + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull ^
+        key->hash * 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return (size_t)h;
+}
+
+    static bool
+ss_tm_ntm_key_equal(
+    const struct ss_tm_ntm_key *a,
+    const struct ss_tm_ntm_key *b) {
+
+    return a->state == b->state && a->head == b->head && a->hash == b->hash &&
+        a->tape_used == b->tape_used &&
+        memcmp(a->tape, b->tape, a->tape_used * sizeof(uint64_t)) == 0;
+}
+
+// The number of cells of tape up to its last non-blank one.
+    static size_t
+ss_tm_ntm_tape_used(
+    const uint64_t *tape,
+    size_t tape_size) {
+
+    while(tape_size > 0 && tape[tape_size - 1] == 0)
+        tape_size--;
+    return tape_size;
+}
+
+// Adds key to the visited set, copying its tape. Returns SS_TM_ERR_NO_ERROR
+// and sets *out_inserted to whether it was new.
+    static enum ss_tm_err
+ss_tm_ntm_visit(
+    struct ss_tm_ntm_shared *shared,
+    const struct ss_tm_ntm_key *key,
+    bool *out_inserted) {
+
+    size_t h = ss_tm_ntm_key_slot(key);
+    struct ss_tm_ntm_stripe *stripe = &shared->stripes[(uint64_t)h >> SS_TM_NTM_STRIPE_SHIFT];
+    pthread_mutex_lock(&stripe->lock);
+
+    // Keep the load factor at or below 1/2.
+    if((stripe->count + 1) * 2 > stripe->size) {
+        size_t size = stripe->size ? stripe->size * 2 : SS_TM_NTM_INITIAL_STRIPE_SIZE;
+        if(!ss_tm_ntm_reserve(shared, size * sizeof(struct ss_tm_ntm_key))) {
+            pthread_mutex_unlock(&stripe->lock);
+            return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+        }
+        struct ss_tm_ntm_key *keys = (struct ss_tm_ntm_key *)calloc(
+            size, sizeof(struct ss_tm_ntm_key));
+        if(!keys) {
+            ss_tm_ntm_release(shared, size * sizeof(struct ss_tm_ntm_key));
+            pthread_mutex_unlock(&stripe->lock);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        size_t i;
+        for(i = 0; i < stripe->size; i++) {
+            const struct ss_tm_ntm_key *old = &stripe->keys[i];
+            if(!old->tape)
+                continue;
+            size_t slot = ss_tm_ntm_key_slot(old) & (size - 1);
+            while(keys[slot].tape)
+                slot = (slot + 1) & (size - 1);
+            keys[slot] = *old;
+        }
+        free(stripe->keys);
+        ss_tm_ntm_release(shared, stripe->size * sizeof(struct ss_tm_ntm_key));
+        stripe->keys = keys;
+        stripe->size = size;
+    }
+
+    size_t slot = h & (stripe->size - 1);
+    while(true) {
+        struct ss_tm_ntm_key *k = &stripe->keys[slot];
+        if(!k->tape)
+            break;
+        if(ss_tm_ntm_key_equal(k, key)) {
+            pthread_mutex_unlock(&stripe->lock);
+            *out_inserted = false;
+            return SS_TM_ERR_NO_ERROR;
+        }
+        slot = (slot + 1) & (stripe->size - 1);
+    }
+
+    const uint64_t *tape = ss_tm_ntm_no_cells;
+    if(key->tape_used) {
+        size_t bytes = key->tape_used * sizeof(uint64_t);
+        if(!ss_tm_ntm_reserve(shared, bytes)) {
+            pthread_mutex_unlock(&stripe->lock);
+            return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+        }
+        uint64_t *copy = (uint64_t *)malloc(bytes);
+        if(!copy) {
+            ss_tm_ntm_release(shared, bytes);
+            pthread_mutex_unlock(&stripe->lock);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        memcpy(copy, key->tape, bytes);
+        tape = copy;
+    }
+    stripe->keys[slot] = *key;
+    stripe->keys[slot].tape = tape;
+    stripe->count++;
+    pthread_mutex_unlock(&stripe->lock);
+
+    __atomic_add_fetch(&shared->num_visited, 1, __ATOMIC_RELAXED);
+    *out_inserted = true;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static bool
+ss_tm_ntm_entry_less(
+    const struct ss_tm_ntm_entry *a,
+    const struct ss_tm_ntm_entry *b) {
+
+    return a->priority < b->priority ||
+        (a->priority == b->priority && a->seq < b->seq);
+}
+
+// Queues config, which then belongs to the queue.
+    static enum ss_tm_err
+ss_tm_ntm_push(
+    struct ss_tm_ntm_shared *shared,
+    struct ss_tm_ntm_config *config) {
+
+    double priority = (double)config->depth;
+    if(shared->options->strategy == SS_TM_NTM_BEST_FIRST && shared->options->score) {
+        priority = shared->options->score(
+            shared->options->user_data,
+            config->state,
+            config->head,
+            config->tape,
+            config->tape_size,
+            config->depth);
+    }
+
+    pthread_mutex_lock(&shared->lock);
+    if(shared->heap_end == shared->heap_size) {
+        size_t size = shared->heap_size ? shared->heap_size * 2 : 1024;
+        size_t added = (size - shared->heap_size) * sizeof(struct ss_tm_ntm_entry);
+        if(!ss_tm_ntm_reserve(shared, added)) {
+            pthread_mutex_unlock(&shared->lock);
+            return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+        }
+        struct ss_tm_ntm_entry *heap = (struct ss_tm_ntm_entry *)realloc(
+            shared->heap, size * sizeof(struct ss_tm_ntm_entry));
+        if(!heap) {
+            ss_tm_ntm_release(shared, added);
+            pthread_mutex_unlock(&shared->lock);
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        }
+        shared->heap = heap;
+        shared->heap_size = size;
+    }
+
+    struct ss_tm_ntm_entry entry;
+    entry.priority = priority;
+    entry.seq = shared->next_seq++;
+    entry.config = config;
+    size_t i = shared->heap_end++;
+    while(i > 0) {
+        size_t parent = (i - 1) / 2;
+        if(!ss_tm_ntm_entry_less(&entry, &shared->heap[parent]))
+            break;
+        shared->heap[i] = shared->heap[parent];
+        i = parent;
+    }
+    shared->heap[i] = entry;
+    pthread_cond_signal(&shared->cond);
+    pthread_mutex_unlock(&shared->lock);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Pops the best entry. Call with shared->lock held and the heap non-empty.
+    static struct ss_tm_ntm_config *
+ss_tm_ntm_pop_locked(
+    struct ss_tm_ntm_shared *shared) {
+
+    struct ss_tm_ntm_config *config = shared->heap[0].config;
+    struct ss_tm_ntm_entry last = shared->heap[--shared->heap_end];
+    size_t i = 0;
+    while(true) {
+        size_t child = 2 * i + 1;
+        if(child >= shared->heap_end)
+            break;
+        if(child + 1 < shared->heap_end &&
+            ss_tm_ntm_entry_less(&shared->heap[child + 1], &shared->heap[child])) {
+
+            child++;
+        }
+        if(!ss_tm_ntm_entry_less(&shared->heap[child], &last))
+            break;
+        shared->heap[i] = shared->heap[child];
+        i = child;
+    }
+    if(shared->heap_end > 0)
+        shared->heap[i] = last;
+    return config;
+}
+
+    static size_t
+ss_tm_ntm_config_bytes(
+    size_t tape_size) {
+
+    return sizeof(struct ss_tm_ntm_config) + tape_size * sizeof(uint64_t);
+}
+
+// Queues the configurations config leads to that haven't been seen.
+    static void
+ss_tm_ntm_expand(
+    struct ss_tm_ntm_shared *shared,
+    const struct ss_tm_ntm_config *config) {
+
+    uint64_t in_char = config->tape[config->head];
+    const struct ss_tm_transition *transitions;
+    size_t num_transitions;
+    ss_tm_find_transitions(shared->machine, config->state, in_char,
+        &transitions, &num_transitions);
+
+    uint64_t depth = config->depth + 1;
+    size_t i;
+    for(i = 0; i < num_transitions; i++) {
+        const struct ss_tm_transition *t = &transitions[i];
+        if(!t->out_right && config->head == 0)
+            continue;
+        // Past max_depth nothing is explored, not even an accept.
+        if(depth > shared->options->max_depth) {
+            __atomic_store_n(&shared->cut_off, true, __ATOMIC_RELAXED);
+            continue;
+        }
+        if(t->out_state == SS_TM_ACCEPT_STATE) {
+            pthread_mutex_lock(&shared->lock);
+            if(!shared->accepted || depth < shared->accept_depth) {
+                shared->accepted = true;
+                shared->accept_depth = depth;
+            }
+            ss_tm_ntm_finish_locked(shared);
+            pthread_mutex_unlock(&shared->lock);
+            return;
+        }
+        if(t->out_state == SS_TM_REJECT_STATE)
+            continue;
+
+        // Replace the written cell's term of the hash.
+        uint64_t written = ss_tm_hash_reduce(t->out_char);
+        uint64_t old = ss_tm_hash_reduce(in_char);
+        uint64_t delta = written >= old ?
+            written - old : written + SS_TM_HASH_MODULUS - old;
+        struct ss_tm_ntm_key key;
+        key.state = t->out_state;
+        key.head = t->out_right ? config->head + 1 : config->head - 1;
+        key.hash = ss_tm_hash_reduce(
+            (unsigned __int128)ss_tm_hash_mul(delta, config->head_power) + config->hash);
+
+        // The child is built before it's looked up, as the visited set
+        // compares tapes.
+        size_t tape_size = config->tape_size;
+        if(key.head == tape_size)
+            tape_size++;
+        size_t bytes = ss_tm_ntm_config_bytes(tape_size);
+        if(!ss_tm_ntm_reserve(shared, bytes)) {
+            ss_tm_ntm_fail(shared, SS_TM_ERR_MEMORY_LIMIT_REACHED);
+            return;
+        }
+        struct ss_tm_ntm_config *child = (struct ss_tm_ntm_config *)malloc(bytes);
+        if(!child) {
+            ss_tm_ntm_release(shared, bytes);
+            ss_tm_ntm_fail(shared, SS_TM_ERR_ALLOCATION_FAILED);
+            return;
+        }
+        child->state = key.state;
+        child->head = key.head;
+        child->depth = depth;
+        child->hash = key.hash;
+        child->head_power = ss_tm_hash_mul(config->head_power,
+            t->out_right ? SS_TM_HASH_BASE : shared->base_inverse);
+        child->tape_size = tape_size;
+        memcpy(child->tape, config->tape, config->tape_size * sizeof(uint64_t));
+        if(tape_size > config->tape_size)
+            child->tape[config->tape_size] = 0;
+        child->tape[config->head] = t->out_char;
+
+        key.tape = child->tape;
+        key.tape_used = ss_tm_ntm_tape_used(child->tape, child->tape_size);
+        bool inserted;
+        enum ss_tm_err e = ss_tm_ntm_visit(shared, &key, &inserted);
+        if(e != SS_TM_ERR_NO_ERROR || !inserted) {
+            free(child);
+            ss_tm_ntm_release(shared, bytes);
+            if(e != SS_TM_ERR_NO_ERROR) {
+                ss_tm_ntm_fail(shared, e);
+                return;
+            }
+            continue;
+        }
+
+        e = ss_tm_ntm_push(shared, child);
+        if(e != SS_TM_ERR_NO_ERROR) {
+            free(child);
+            ss_tm_ntm_release(shared, bytes);
+            ss_tm_ntm_fail(shared, e);
+            return;
+        }
+    }
+}
+
+    static void *
+ss_tm_ntm_worker(
+    void *arg) {
+
+    struct ss_tm_ntm_shared *shared = (struct ss_tm_ntm_shared *)arg;
+    pthread_mutex_lock(&shared->lock);
+    while(true) {
+        while(!shared->done && shared->heap_end == 0 && shared->num_busy > 0)
+            pthread_cond_wait(&shared->cond, &shared->lock);
+        if(shared->done)
+            break;
+        if(shared->heap_end == 0) {
+            // Nothing queued and nobody expanding: every branch has ended.
+            ss_tm_ntm_finish_locked(shared);
+            break;
+        }
+
+        struct ss_tm_ntm_config *config = ss_tm_ntm_pop_locked(shared);
+        shared->num_busy++;
+        shared->num_expanded++;
+        if(config->depth > shared->max_depth_reached)
+            shared->max_depth_reached = config->depth;
+        pthread_mutex_unlock(&shared->lock);
+
+        ss_tm_ntm_expand(shared, config);
+        ss_tm_ntm_release(shared, ss_tm_ntm_config_bytes(config->tape_size));
+        free(config);
+
+        pthread_mutex_lock(&shared->lock);
+        shared->num_busy--;
+        if(shared->num_busy == 0 && shared->heap_end == 0)
+            pthread_cond_broadcast(&shared->cond);
+    }
+    pthread_mutex_unlock(&shared->lock);
+    return NULL;
+}
+
+// Queues the start configuration.
+    static enum ss_tm_err
+ss_tm_ntm_push_start(
+    struct ss_tm_ntm_shared *shared,
+    const uint64_t *input_string,
+    size_t input_string_size) {
+
+    size_t tape_size = input_string_size ? input_string_size : 1;
+    size_t bytes = ss_tm_ntm_config_bytes(tape_size);
+    if(!ss_tm_ntm_reserve(shared, bytes))
+        return SS_TM_ERR_MEMORY_LIMIT_REACHED;
+    struct ss_tm_ntm_config *start = (struct ss_tm_ntm_config *)malloc(bytes);
+    if(!start) {
+        ss_tm_ntm_release(shared, bytes);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    start->state = SS_TM_INITIAL_STATE;
+    start->head = 0;
+    start->depth = 0;
+    start->head_power = 1;
+    start->tape_size = tape_size;
+    start->tape[0] = 0;
+    if(input_string_size)
+        memcpy(start->tape, input_string, input_string_size * sizeof(uint64_t));
+
+    uint64_t hash = 0;
+    uint64_t power = 1;
+    size_t i;
+    for(i = 0; i < tape_size; i++) {
+        hash = ss_tm_hash_reduce((unsigned __int128)ss_tm_hash_mul(ss_tm_hash_reduce(start->tape[i]), power) + hash);
+        power = ss_tm_hash_mul(power, SS_TM_HASH_BASE);
+    }
+    start->hash = hash;
+
+    struct ss_tm_ntm_key key;
+    key.state = start->state;
+    key.head = start->head;
+    key.hash = start->hash;
+    key.tape = start->tape;
+    key.tape_used = ss_tm_ntm_tape_used(start->tape, start->tape_size);
+    bool inserted;
+    enum ss_tm_err e = ss_tm_ntm_visit(shared, &key, &inserted);
+    if(e == SS_TM_ERR_NO_ERROR)
+        e = ss_tm_ntm_push(shared, start);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        free(start);
+        ss_tm_ntm_release(shared, bytes);
+    }
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_ntm_explore(
+    const struct ss_tm *machine,
+    const uint64_t *input_string,
+    size_t input_string_size,
+    const struct ss_tm_ntm_options *options,
+    struct ss_tm_ntm_result *out_result) {
+
+    memset(out_result, 0, sizeof(*out_result));
+    if(!machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+    enum ss_tm_err e = ss_tm_validate_input(input_string, input_string_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    size_t num_threads = options->num_threads;
+    if(num_threads == 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = num_cpus > 0 ? (size_t)num_cpus : 1;
+    }
+
+    struct ss_tm_ntm_shared *shared = (struct ss_tm_ntm_shared *)calloc(
+        1, sizeof(struct ss_tm_ntm_shared));
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    if(!shared || !threads) {
+        free(shared);
+        free(threads);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    shared->machine = machine;
+    shared->options = options;
+    // By Fermat's little theorem, as the modulus is prime.
+    shared->base_inverse = ss_tm_hash_power(SS_TM_HASH_MODULUS - 2);
+    size_t i;
+    for(i = 0; i < SS_TM_NTM_NUM_STRIPES; i++)
+        pthread_mutex_init(&shared->stripes[i].lock, NULL);
+    pthread_mutex_init(&shared->lock, NULL);
+    pthread_cond_init(&shared->cond, NULL);
+    shared->err = SS_TM_ERR_NO_ERROR;
+
+    e = ss_tm_ntm_push_start(shared, input_string, input_string_size);
+    if(e == SS_TM_ERR_MEMORY_LIMIT_REACHED)
+        shared->space_limit = true;
+    else if(e != SS_TM_ERR_NO_ERROR)
+        shared->err = e;
+    else {
+        size_t num_started;
+        for(num_started = 0; num_started < num_threads; num_started++) {
+            if(pthread_create(&threads[num_started], NULL, ss_tm_ntm_worker, shared))
+                break;
+        }
+        // Workers that did start still explore everything, so a partial
+        // failure only costs parallelism.
+        if(num_started == 0)
+            shared->err = SS_TM_ERR_THREAD_CREATE_FAILED;
+        for(i = 0; i < num_started; i++)
+            pthread_join(threads[i], NULL);
+    }
+
+    if(shared->accepted) {
+        out_result->outcome = SS_TM_OUTCOME_ACCEPT;
+        out_result->accept_depth = shared->accept_depth;
+    } else if(shared->space_limit) {
+        out_result->outcome = SS_TM_OUTCOME_SPACE_LIMIT;
+    } else if(shared->err != SS_TM_ERR_NO_ERROR) {
+        out_result->outcome = SS_TM_OUTCOME_ERROR;
+        out_result->err = shared->err;
+    } else if(shared->cut_off) {
+        out_result->outcome = SS_TM_OUTCOME_TIMEOUT;
+    } else {
+        out_result->outcome = SS_TM_OUTCOME_REJECT;
+    }
+    out_result->num_expanded = shared->num_expanded;
+    out_result->num_visited = shared->num_visited;
+    out_result->max_depth_reached = shared->max_depth_reached;
+    out_result->peak_memory = shared->peak_memory;
+
+    while(shared->heap_end > 0)
+        free(ss_tm_ntm_pop_locked(shared));
+    free(shared->heap);
+    for(i = 0; i < SS_TM_NTM_NUM_STRIPES; i++) {
+        struct ss_tm_ntm_stripe *stripe = &shared->stripes[i];
+        size_t j;
+        for(j = 0; j < stripe->size; j++) {
+            if(stripe->keys[j].tape && stripe->keys[j].tape != ss_tm_ntm_no_cells)
+                free((void *)stripe->keys[j].tape);
+        }
+        free(shared->stripes[i].keys);
+        pthread_mutex_destroy(&shared->stripes[i].lock);
+    }
+    pthread_cond_destroy(&shared->cond);
+    pthread_mutex_destroy(&shared->lock);
+    free(shared);
+    free(threads);
+    return SS_TM_ERR_NO_ERROR;
+}
@@ -0,0 +1,84 @@
+#ifndef ss_tm_ntm_h
+#define ss_tm_ntm_h
+
+#include "ss_tm.h"
+
+// Explores every branch of a nondeterministic machine (see
+// ss_tm_init_begin_nondeterministic) on one input, across worker threads,
+// until some branch accepts.
+//
+// Configurations wait in a shared priority queue. Workers take the best
+// one, apply each transition matching it, and queue the resulting
+// configurations that haven't been seen before. Configurations are
+// deduplicated in a concurrent hash set, split into independently locked
+// stripes, keyed on (state, head, tape hash). The tape hash is the sum of
+// cell * base^position modulo 2^61 - 1, so trailing blanks don't change it
+// and each step updates it in constant time. It can't tell apart every pair
+// of tapes (cells differing by a multiple of the modulus hash alike), so the
+// set also keeps each tape up to its last non-blank cell and compares them
+// when the three words match; that copy counts against memory_limit.
+//
+// A branch ends when it reaches the reject state, has no matching
+// transition, or would move off the left end of the tape.
+
+enum ss_tm_ntm_strategy {
+    // Shallowest configuration first. With one thread, the accepting branch
+    // found is a shortest one.
+    SS_TM_NTM_BREADTH_FIRST,
+    // Lowest score first; see ss_tm_ntm_score_fn.
+    SS_TM_NTM_BEST_FIRST
+};
+
+// Scores a configuration for SS_TM_NTM_BEST_FIRST. Lower scores are
+// explored first. Called from the worker threads, possibly concurrently.
+typedef double (*ss_tm_ntm_score_fn)(
+    void *user_data,
+    uint64_t state,
+    size_t head,
+    const uint64_t *tape,
+    size_t tape_size,
+    uint64_t depth);
+
+struct ss_tm_ntm_options {
+    enum ss_tm_ntm_strategy strategy;
+    // Configurations more than this many steps from the start aren't
+    // explored.
+    uint64_t max_depth;
+    // Bytes that queued configurations and the visited set may use between
+    // them. 0 means no limit.
+    size_t memory_limit;
+    // 0 uses one thread per online CPU.
+    size_t num_threads;
+    // Used by SS_TM_NTM_BEST_FIRST, which without it explores breadth first.
+    ss_tm_ntm_score_fn score;
+    void *user_data;
+};
+
+struct ss_tm_ntm_result {
+    // ACCEPT if some branch accepted; REJECT if every branch ended first;
+    // TIMEOUT if neither, but some branch was cut off at max_depth;
+    // SPACE_LIMIT if the memory limit was reached first; ERROR otherwise.
+    enum ss_tm_outcome outcome;
+    enum ss_tm_err err;
+    // Depth of the accepting configuration, if one was found.
+    uint64_t accept_depth;
+    // Configurations taken from the queue and expanded.
+    uint64_t num_expanded;
+    // Distinct configurations seen, including the start.
+    uint64_t num_visited;
+    uint64_t max_depth_reached;
+    size_t peak_memory;
+};
+
+// Explores machine, which must be initialized, from the start configuration
+// on input_string. The return value only reports problems with the
+// arguments; how the exploration ended is in out_result.
+    enum ss_tm_err
+ss_tm_ntm_explore(
+    const struct ss_tm *machine,
+    const uint64_t *input_string,
+    size_t input_string_size,
+    const struct ss_tm_ntm_options *options,
+    struct ss_tm_ntm_result *out_result);
+
+#endif // #ifndef ss_tm_ntm_h
@@ -0,0 +1,297 @@
+#include "ss_tm_results.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char ss_tm_results_magic[8] = {'S', 'S', 'T', 'M', 'R', 'E', 'S', '1'};
+
+// 4096 records is a little under half a megabyte per buffer.
+#define SS_TM_RESULTS_BUFFER_SIZE 4096
+
+struct ss_tm_results_header {
+    char magic[8];
+    uint64_t record_size;
+};
+
+    static bool
+ss_tm_results_write_all(
+    int fd,
+    const void *data,
+    size_t size) {
+
+    const char *p = (const char *)data;
+    while(size > 0) {
+        ssize_t written = write(fd, p, size);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+    enum ss_tm_err
+ss_tm_results_summarize(
+    struct ss_tm *tm,
+    struct ss_tm_results_record *record) {
+
+    uint64_t *tape;
+    size_t tape_size;
+    enum ss_tm_err e = ss_tm_peek_tape_all(tm, &tape, &tape_size);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    ss_tm_peek_state(tm, &record->final_state);
+    ss_tm_peek_steps(tm, &record->steps);
+
+    while(tape_size > 0 && tape[tape_size - 1] == 0)
+        tape_size--;
+    uint64_t nonblank = 0;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i;
+    for(i = 0; i < tape_size; i++) {
+        nonblank += tape[i] != 0;
+        int b;
+        for(b = 0; b < 64; b += 8) {
+            hash ^= (tape[i] >> b) & 0xFF;
+            hash *= 0x100000001B3ull;
+        }
+    }
+    record->tape_size = tape_size;
+    record->tape_nonblank = nonblank;
+    record->tape_hash = hash;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static void *
+ss_tm_results_io_thread(
+    void *arg) {
+
+    struct ss_tm_results_sink *self = (struct ss_tm_results_sink *)arg;
+
+    pthread_mutex_lock(&self->lock);
+    while(true) {
+        while(!(self->front_end == self->buffer_size || self->closing ||
+            (self->front_end > 0 && self->records_submitted < self->flush_target))) {
+
+            pthread_cond_wait(&self->work_cond, &self->lock);
+        }
+        if(self->front_end == 0 && self->closing)
+            break;
+
+        struct ss_tm_results_record *to_write = self->front;
+        size_t num_to_write = self->front_end;
+        self->front = self->back;
+        self->back = to_write;
+        self->front_end = 0;
+        self->records_submitted += num_to_write;
+        // Producers waiting on a full buffer can go on filling the other one.
+        pthread_cond_broadcast(&self->done_cond);
+        pthread_mutex_unlock(&self->lock);
+
+        bool ok = ss_tm_results_write_all(
+            self->fd,
+            to_write,
+            num_to_write * sizeof(struct ss_tm_results_record));
+
+        pthread_mutex_lock(&self->lock);
+        if(!ok && self->io_err == SS_TM_ERR_NO_ERROR)
+            self->io_err = SS_TM_ERR_IO_FAILED;
+        self->records_written += num_to_write;
+        pthread_cond_broadcast(&self->done_cond);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+    enum ss_tm_err
+ss_tm_results_open(
+    struct ss_tm_results_sink *self,
+    const char *path,
+    uint64_t num_records_to_keep,
+    uint64_t *out_num_records) {
+
+    self->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(self->fd < 0)
+        return SS_TM_ERR_IO_FAILED;
+
+    struct stat st;
+    if(fstat(self->fd, &st) != 0) {
+        close(self->fd);
+        return SS_TM_ERR_IO_FAILED;
+    }
+
+    uint64_t num_records = 0;
+    if(st.st_size < (off_t)sizeof(struct ss_tm_results_header)) {
+        // Empty, or a crash came before the header was all written. Either 
+        // way there are no records, so start over.
+        struct ss_tm_results_header header;
+        memcpy(header.magic, ss_tm_results_magic, sizeof(header.magic));
+        header.record_size = sizeof(struct ss_tm_results_record);
+        if(ftruncate(self->fd, 0) != 0 ||
+            !ss_tm_results_write_all(self->fd, &header, sizeof(header))) {
+            close(self->fd);
+            return SS_TM_ERR_IO_FAILED;
+        }
+    } else {
+        struct ss_tm_results_header header;
+        if(pread(self->fd, &header, sizeof(header), 0) != sizeof(header) ||
+            memcmp(header.magic, ss_tm_results_magic, sizeof(header.magic)) != 0 ||
+            header.record_size != sizeof(struct ss_tm_results_record)) {
+
+            close(self->fd);
+            return SS_TM_ERR_BAD_FILE_FORMAT;
+        }
+        // A torn record at the end from a crash is dropped along with
+        // anything past num_records_to_keep.
+        num_records = (st.st_size - sizeof(header)) / sizeof(struct ss_tm_results_record);
+        if(num_records > num_records_to_keep)
+            num_records = num_records_to_keep;
+        off_t end = sizeof(header) + num_records * sizeof(struct ss_tm_results_record);
+        if(ftruncate(self->fd, end) != 0 || lseek(self->fd, end, SEEK_SET) != end) {
+            close(self->fd);
+            return SS_TM_ERR_IO_FAILED;
+        }
+    }
+
+    self->buffer_size = SS_TM_RESULTS_BUFFER_SIZE;
+    self->front = (struct ss_tm_results_record *)malloc(
+        sizeof(struct ss_tm_results_record) * self->buffer_size);
+    self->back = (struct ss_tm_results_record *)malloc(
+        sizeof(struct ss_tm_results_record) * self->buffer_size);
+    if(!self->front || !self->back) {
+        free(self->front);
+        free(self->back);
+        close(self->fd);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->front_end = 0;
+    self->records_appended = num_records;
+    self->records_submitted = num_records;
+    self->records_written = num_records;
+    self->flush_target = 0;
+    self->closing = false;
+    self->io_err = SS_TM_ERR_NO_ERROR;
+
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->work_cond, NULL);
+    pthread_cond_init(&self->done_cond, NULL);
+    if(pthread_create(&self->io_thread, NULL, ss_tm_results_io_thread, self)) {
+        pthread_cond_destroy(&self->done_cond);
+        pthread_cond_destroy(&self->work_cond);
+        pthread_mutex_destroy(&self->lock);
+        free(self->front);
+        free(self->back);
+        close(self->fd);
+        return SS_TM_ERR_THREAD_CREATE_FAILED;
+    }
+
+    if(out_num_records)
+        *out_num_records = num_records;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_results_append(
+    struct ss_tm_results_sink *self,
+    const struct ss_tm_results_record *record) {
+
+    pthread_mutex_lock(&self->lock);
+    while(self->front_end == self->buffer_size && self->io_err == SS_TM_ERR_NO_ERROR)
+        pthread_cond_wait(&self->done_cond, &self->lock);
+    enum ss_tm_err e = self->io_err;
+    if(e == SS_TM_ERR_NO_ERROR) {
+        self->front[self->front_end++] = *record;
+        self->records_appended++;
+        if(self->front_end == self->buffer_size)
+            pthread_cond_signal(&self->work_cond);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_results_flush(
+    struct ss_tm_results_sink *self,
+    uint64_t *out_num_records) {
+
+    pthread_mutex_lock(&self->lock);
+    uint64_t target = self->records_appended;
+    if(self->flush_target < target)
+        self->flush_target = target;
+    pthread_cond_signal(&self->work_cond);
+    while(self->records_written < target && self->io_err == SS_TM_ERR_NO_ERROR)
+        pthread_cond_wait(&self->done_cond, &self->lock);
+    enum ss_tm_err e = self->io_err;
+    pthread_mutex_unlock(&self->lock);
+
+    if(e == SS_TM_ERR_NO_ERROR && fdatasync(self->fd) != 0)
+        e = SS_TM_ERR_IO_FAILED;
+    if(e == SS_TM_ERR_NO_ERROR && out_num_records)
+        *out_num_records = target;
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_results_close(
+    struct ss_tm_results_sink *self) {
+
+    enum ss_tm_err e = ss_tm_results_flush(self, NULL);
+
+    pthread_mutex_lock(&self->lock);
+    self->closing = true;
+    pthread_cond_signal(&self->work_cond);
+    pthread_mutex_unlock(&self->lock);
+    pthread_join(self->io_thread, NULL);
+
+    pthread_cond_destroy(&self->done_cond);
+    pthread_cond_destroy(&self->work_cond);
+    pthread_mutex_destroy(&self->lock);
+    free(self->front);
+    free(self->back);
+    if(close(self->fd) != 0 && e == SS_TM_ERR_NO_ERROR)
+        e = SS_TM_ERR_IO_FAILED;
+    return e;
+}
+
+    enum ss_tm_err
+ss_tm_results_reader_open(
+    struct ss_tm_results_reader *self,
+    const char *path) {
+
+    self->f = fopen(path, "rb");
+    if(!self->f)
+        return SS_TM_ERR_IO_FAILED;
+
+    struct ss_tm_results_header header;
+    if(fread(&header, sizeof(header), 1, self->f) != 1 ||
+        memcmp(header.magic, ss_tm_results_magic, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(struct ss_tm_results_record)) {
+
+        fclose(self->f);
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    bool
+ss_tm_results_reader_next(
+    struct ss_tm_results_reader *self,
+    struct ss_tm_results_record *out_record) {
+
+    return fread(out_record, sizeof(*out_record), 1, self->f) == 1;
+}
+
+    enum ss_tm_err
+ss_tm_results_reader_close(
+    struct ss_tm_results_reader *self) {
+
+    fclose(self->f);
+    return SS_TM_ERR_NO_ERROR;
+}
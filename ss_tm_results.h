@@ -0,0 +1,120 @@
+#ifndef ss_tm_results_h
+#define ss_tm_results_h
+
+#include "ss_tm.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Append-only log of fixed-size result records. Appends are copied into a
+// memory buffer, and a dedicated I/O thread writes full buffers to the file,
+// so producers never block on the file system unless the I/O thread falls a
+// whole buffer behind.
+//
+// The file is an 8-byte magic ("SSTMRES1") and the record size as a
+// uint64_t, followed by the records back to back, all in host byte order.
+
+#define SS_TM_RESULTS_PACKED_TABLE_SIZE 64
+
+struct ss_tm_results_record {
+    // Identifies the machine within whatever produced it, such as its index
+    // in an enumeration.
+    uint64_t candidate_index;
+    uint64_t final_state;
+    uint64_t steps;
+    // Summary of the tape when the record was made.
+    uint64_t tape_size;
+    uint64_t tape_nonblank;
+    uint64_t tape_hash;
+    // The machine's transition table, packed however the producer likes.
+    uint8_t packed_table[SS_TM_RESULTS_PACKED_TABLE_SIZE];
+};
+
+// Fills in the final state, step count, and tape summary of record from tm's
+// current configuration. tape_size counts the cells up to the last non-blank
+// one, and tape_hash is FNV-1a over those cells.
+    enum ss_tm_err
+ss_tm_results_summarize(
+    struct ss_tm *tm,
+    struct ss_tm_results_record *record);
+
+struct ss_tm_results_sink {
+    int fd;
+    pthread_t io_thread;
+    pthread_mutex_t lock;
+    // Signalled when the I/O thread has work.
+    pthread_cond_t work_cond;
+    // Signalled when the I/O thread has taken a buffer or finished a write.
+    pthread_cond_t done_cond;
+
+    // Producers fill front. The I/O thread swaps it with back and writes back
+    // without holding the lock.
+    struct ss_tm_results_record *front;
+    struct ss_tm_results_record *back;
+    size_t front_end;
+    size_t buffer_size;
+
+    // Counts of records since the log was opened, including the ones kept
+    // from before.
+    uint64_t records_appended;
+    uint64_t records_submitted;
+    uint64_t records_written;
+    // The I/O thread writes out a partly filled buffer while
+    // records_submitted < flush_target.
+    uint64_t flush_target;
+    bool closing;
+    // The first write error, after which the sink accepts no more records.
+    enum ss_tm_err io_err;
+};
+
+// Opens the log at path, creating it if needed. Records past the first
+// num_records_to_keep are discarded, so a producer resuming from a
+// checkpoint can drop whatever it appended after the checkpoint was taken.
+// Pass UINT64_MAX to keep every record. out_num_records receives the number
+// of records kept and may be NULL. A file too short to hold the header, as a
+// crash while creating it can leave, is taken to be empty.
+    enum ss_tm_err
+ss_tm_results_open(
+    struct ss_tm_results_sink *self,
+    const char *path,
+    uint64_t num_records_to_keep,
+    uint64_t *out_num_records);
+
+    enum ss_tm_err
+ss_tm_results_append(
+    struct ss_tm_results_sink *self,
+    const struct ss_tm_results_record *record);
+
+// Blocks until every record appended so far is written and synced to disk.
+// out_num_records receives the number of records durably in the log and may
+// be NULL.
+    enum ss_tm_err
+ss_tm_results_flush(
+    struct ss_tm_results_sink *self,
+    uint64_t *out_num_records);
+
+// Flushes, stops the I/O thread, and closes the file.
+    enum ss_tm_err
+ss_tm_results_close(
+    struct ss_tm_results_sink *self);
+
+struct ss_tm_results_reader {
+    FILE *f;
+};
+
+    enum ss_tm_err
+ss_tm_results_reader_open(
+    struct ss_tm_results_reader *self,
+    const char *path);
+
+// Returns false at the end of the log.
+    bool
+ss_tm_results_reader_next(
+    struct ss_tm_results_reader *self,
+    struct ss_tm_results_record *out_record);
+
+    enum ss_tm_err
+ss_tm_results_reader_close(
+    struct ss_tm_results_reader *self);
+
+#endif // #ifndef ss_tm_results_h
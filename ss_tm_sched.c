@@ -0,0 +1,229 @@
+#include "ss_tm_sched.h"
+
+#include <stdlib.h>
+
+    enum ss_tm_err
+ss_tm_sched_init(
+    struct ss_tm_sched *self,
+    enum ss_tm_sched_policy policy,
+    uint64_t slice_steps,
+    size_t memory_limit) {
+
+    self->policy = policy;
+    self->slice_steps = slice_steps ? slice_steps : 1;
+    self->classify = NULL;
+    self->classify_user_data = NULL;
+
+    self->slots = (struct ss_tm_sched_slot *)malloc(sizeof(struct ss_tm_sched_slot) * 16);
+    if(!self->slots)
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    self->slots_end = 0;
+    self->slots_size = 16;
+    self->cursor = 0;
+    self->next_id = 0;
+
+    self->completions = (struct ss_tm_sched_completion *)malloc(
+        sizeof(struct ss_tm_sched_completion) * 16);
+    if(!self->completions) {
+        free(self->slots);
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    }
+    self->completions_begin = 0;
+    self->completions_end = 0;
+    self->completions_size = 16;
+
+    return ss_tm_budget_init(&self->budget, memory_limit, NULL);
+}
+
+    enum ss_tm_err
+ss_tm_sched_destroy(
+    struct ss_tm_sched *self) {
+
+    size_t i;
+    for(i = 0; i < self->slots_end; i++)
+        ss_tm_destroy(&self->slots[i].sim);
+    free(self->slots);
+    free(self->completions);
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_sched_set_classifier(
+    struct ss_tm_sched *self,
+    ss_tm_sched_classify_fn classify,
+    void *user_data) {
+
+    self->classify = classify;
+    self->classify_user_data = user_data;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_sched_add(
+    struct ss_tm_sched *self,
+    struct ss_tm *machine,
+    uint64_t *input_string,
+    size_t input_string_size,
+    uint64_t *out_id) {
+
+    if(self->slots_size == self->slots_end) {
+        struct ss_tm_sched_slot *slots = (struct ss_tm_sched_slot *)realloc(
+            self->slots,
+            sizeof(struct ss_tm_sched_slot) * self->slots_size * 2);
+        if(!slots)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        self->slots = slots;
+        self->slots_size *= 2;
+    }
+
+    struct ss_tm_sched_slot *slot = &self->slots[self->slots_end];
+    enum ss_tm_err e = ss_tm_init_borrow(&slot->sim, machine);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+    // Can't fail: there's no tape yet to move over to the budget.
+    ss_tm_set_space_limits(&slot->sim, machine->max_tape_cells, &self->budget);
+    e = ss_tm_simulation_begin(&slot->sim, input_string, input_string_size);
+    if(e != SS_TM_ERR_NO_ERROR) {
+        ss_tm_destroy(&slot->sim);
+        return e;
+    }
+    slot->id = self->next_id++;
+    slot->slice_steps = self->slice_steps;
+    self->slots_end++;
+
+    if(out_id)
+        *out_id = slot->id;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    static enum ss_tm_err
+ss_tm_sched_push_completion(
+    struct ss_tm_sched *self,
+    struct ss_tm_sched_completion *completion) {
+
+    size_t count = self->completions_end - self->completions_begin;
+    if(count == self->completions_size) {
+        struct ss_tm_sched_completion *completions = (struct ss_tm_sched_completion *)malloc(
+            sizeof(struct ss_tm_sched_completion) * self->completions_size * 2);
+        if(!completions)
+            return SS_TM_ERR_ALLOCATION_FAILED;
+        size_t i;
+        for(i = 0; i < count; i++) {
+            completions[i] = self->completions[
+                (self->completions_begin + i) % self->completions_size];
+        }
+        free(self->completions);
+        self->completions = completions;
+        self->completions_begin = 0;
+        self->completions_end = count;
+        self->completions_size *= 2;
+    }
+    // begin and end only ever grow; they're reduced modulo the size on use.
+    self->completions[self->completions_end % self->completions_size] = *completion;
+    self->completions_end++;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Moves the simulation in slot_index to the completion queue and fills its
+// slot with the last one.
+    static enum ss_tm_err
+ss_tm_sched_evict(
+    struct ss_tm_sched *self,
+    size_t slot_index,
+    enum ss_tm_outcome outcome,
+    enum ss_tm_err err,
+    uint64_t classification) {
+
+    struct ss_tm_sched_slot *slot = &self->slots[slot_index];
+    struct ss_tm_sched_completion completion;
+    completion.id = slot->id;
+    completion.outcome = outcome;
+    completion.err = err;
+    completion.steps = slot->sim.steps;
+    completion.classification = classification;
+    enum ss_tm_err e = ss_tm_sched_push_completion(self, &completion);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    ss_tm_destroy(&slot->sim);
+    self->slots_end--;
+    if(slot_index != self->slots_end)
+        *slot = self->slots[self->slots_end];
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_sched_run_slice(
+    struct ss_tm_sched *self) {
+
+    if(self->slots_end == 0)
+        return SS_TM_ERR_NO_ERROR;
+    if(self->cursor >= self->slots_end)
+        self->cursor = 0;
+
+    size_t slot_index = self->cursor;
+    struct ss_tm_sched_slot *slot = &self->slots[slot_index];
+    enum ss_tm_err e = ss_tm_simulation_step_multiple(&slot->sim, slot->slice_steps);
+    if(self->policy == SS_TM_SCHED_EXPONENTIAL && slot->slice_steps < (1ull << 62))
+        slot->slice_steps *= 2;
+
+    // An evicted slot is refilled from the end, so the cursor only moves on
+    // when the slot's simulation stays.
+    uint64_t classification = 0;
+    if(e == SS_TM_ERR_MEMORY_LIMIT_REACHED) {
+        return ss_tm_sched_evict(
+            self, slot_index, SS_TM_OUTCOME_SPACE_LIMIT, SS_TM_ERR_NO_ERROR, 0);
+    } else if(e != SS_TM_ERR_NO_ERROR && e != SS_TM_ERR_STEP_ON_HALTED_MACHINE) {
+        return ss_tm_sched_evict(self, slot_index, SS_TM_OUTCOME_ERROR, e, 0);
+    } else if(slot->sim.state == SS_TM_ACCEPT_STATE) {
+        return ss_tm_sched_evict(
+            self, slot_index, SS_TM_OUTCOME_ACCEPT, SS_TM_ERR_NO_ERROR, 0);
+    } else if(slot->sim.state == SS_TM_REJECT_STATE) {
+        return ss_tm_sched_evict(
+            self, slot_index, SS_TM_OUTCOME_REJECT, SS_TM_ERR_NO_ERROR, 0);
+    } else if(self->classify && self->classify(
+        self->classify_user_data, slot->id, &slot->sim, &classification)) {
+
+        return ss_tm_sched_evict(
+            self, slot_index, SS_TM_OUTCOME_CLASSIFIED, SS_TM_ERR_NO_ERROR,
+            classification);
+    }
+    self->cursor++;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_sched_run_round(
+    struct ss_tm_sched *self) {
+
+    // Every slice either advances the cursor past a simulation or evicts one,
+    // so running one slice per live simulation covers each exactly once.
+    self->cursor = 0;
+    size_t num_slices = self->slots_end;
+    size_t i;
+    for(i = 0; i < num_slices; i++) {
+        enum ss_tm_err e = ss_tm_sched_run_slice(self);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    bool
+ss_tm_sched_pop_completion(
+    struct ss_tm_sched *self,
+    struct ss_tm_sched_completion *out_completion) {
+
+    if(self->completions_begin == self->completions_end)
+        return false;
+    *out_completion = self->completions[self->completions_begin % self->completions_size];
+    self->completions_begin++;
+    return true;
+}
+
+    size_t
+ss_tm_sched_num_running(
+    struct ss_tm_sched *self) {
+
+    return self->slots_end;
+}
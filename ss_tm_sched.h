@@ -0,0 +1,126 @@
+#ifndef ss_tm_sched_h
+#define ss_tm_sched_h
+
+#include "ss_tm.h"
+
+// Cooperative scheduler that dovetails many simulations which may never
+// halt. Each simulation is advanced a slice of steps at a time, in turn, so
+// that one non-halting machine can't block the others. Simulations leave the
+// scheduler when they halt, error, get classified, or outgrow the memory
+// limit, and are reported through a completion queue.
+
+enum ss_tm_sched_policy {
+    // Every slice is slice_steps long.
+    SS_TM_SCHED_ROUND_ROBIN,
+    // A simulation's slice starts at slice_steps and doubles every time it
+    // runs, so after n rounds each simulation has had about 2^n steps.
+    SS_TM_SCHED_EXPONENTIAL
+};
+
+// Called after each slice of a simulation that hasn't halted. Returning true
+// evicts the simulation with SS_TM_OUTCOME_CLASSIFIED and the value stored to
+// out_classification. sim may be peeked, but not stepped.
+typedef bool (*ss_tm_sched_classify_fn)(
+    void *user_data,
+    uint64_t id,
+    struct ss_tm *sim,
+    uint64_t *out_classification);
+
+struct ss_tm_sched_completion {
+    uint64_t id;
+    enum ss_tm_outcome outcome;
+    // SS_TM_ERR_NO_ERROR unless outcome is SS_TM_OUTCOME_ERROR.
+    enum ss_tm_err err;
+    uint64_t steps;
+    // Only meaningful if outcome is SS_TM_OUTCOME_CLASSIFIED.
+    uint64_t classification;
+};
+
+// Only the fields needed to pick and run the next slice. Kept in one dense
+// array, so a round touches nothing but live simulations.
+struct ss_tm_sched_slot {
+    struct ss_tm sim;
+    uint64_t id;
+    uint64_t slice_steps;
+};
+
+struct ss_tm_sched {
+    enum ss_tm_sched_policy policy;
+    uint64_t slice_steps;
+    ss_tm_sched_classify_fn classify;
+    void *classify_user_data;
+
+    struct ss_tm_sched_slot *slots;
+    size_t slots_end;
+    size_t slots_size;
+    // Index of the slot that runs next.
+    size_t cursor;
+    uint64_t next_id;
+
+    // Ring buffer of completions not yet popped.
+    struct ss_tm_sched_completion *completions;
+    size_t completions_begin;
+    size_t completions_end;
+    size_t completions_size;
+
+    // Charged for the tapes of all running simulations, in place of their
+    // machines' budgets, up to the memory_limit given to ss_tm_sched_init
+    // (0 for no limit). Its parent may be set, before any simulation is 
+    // added, to charge a wider budget as well. The scheduler mustn't move 
+    // while simulations are running, since they point here.
+    struct ss_tm_budget budget;
+};
+
+    enum ss_tm_err
+ss_tm_sched_init(
+    struct ss_tm_sched *self,
+    enum ss_tm_sched_policy policy,
+    uint64_t slice_steps,
+    size_t memory_limit);
+
+    enum ss_tm_err
+ss_tm_sched_destroy(
+    struct ss_tm_sched *self);
+
+// classify may be NULL to turn classification off.
+    enum ss_tm_err
+ss_tm_sched_set_classifier(
+    struct ss_tm_sched *self,
+    ss_tm_sched_classify_fn classify,
+    void *user_data);
+
+// Begins simulating machine on input_string. The scheduler borrows machine's
+// transition table (see ss_tm_init_borrow), so machine must outlive the
+// simulation, and keeps its tape cell limit. Fails with 
+// SS_TM_ERR_MEMORY_LIMIT_REACHED, leaving the scheduler untouched, if the new
+// tape would exceed that or the memory limit. A simulation whose tape can't 
+// grow within them later is evicted with SS_TM_OUTCOME_SPACE_LIMIT.
+    enum ss_tm_err
+ss_tm_sched_add(
+    struct ss_tm_sched *self,
+    struct ss_tm *machine,
+    uint64_t *input_string,
+    size_t input_string_size,
+    uint64_t *out_id);
+
+// Runs one slice of the next simulation in turn.
+    enum ss_tm_err
+ss_tm_sched_run_slice(
+    struct ss_tm_sched *self);
+
+// Runs one slice of every simulation that was running when called.
+    enum ss_tm_err
+ss_tm_sched_run_round(
+    struct ss_tm_sched *self);
+
+// Returns false if the completion queue is empty.
+    bool
+ss_tm_sched_pop_completion(
+    struct ss_tm_sched *self,
+    struct ss_tm_sched_completion *out_completion);
+
+    size_t
+ss_tm_sched_num_running(
+    struct ss_tm_sched *self);
+
+#endif // #ifndef ss_tm_sched_h
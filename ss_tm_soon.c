@@ -0,0 +1,282 @@
+#include "ss_tm_soon.h"
+
+    uint64_t
+ss_tm_soon_symbol(
+    char c) {
+
+    switch(c) {
+        case ' ':
+            return 0ull;
+        case '1':
+            return 1ull;
+        case '[':
+            return 2ull;
+        case ']':
+            return 3ull;
+        case 'a':
+            return 4ull;
+        case 'b':
+            return 5ull;
+        case 'c':
+            return 6ull;
+        default:
+            return SS_TM_SOON_NO_SYMBOL;
+    }
+}
+
+// Adds trans to tm unless an earlier add failed, keeping the first error.
+    static void
+ss_tm_soon_add(
+    struct ss_tm *tm,
+    struct ss_tm_transition trans,
+    enum ss_tm_err *e) {
+
+    if(*e == SS_TM_ERR_NO_ERROR)
+        *e = ss_tm_add_state_transition(tm, trans);
+}
+
+    enum ss_tm_err
+ss_tm_soon_add_emulation(
+    struct ss_tm *tm,
+    uint64_t simulated_start_state) {
+
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    struct ss_tm_transition trans;
+    // States necessary to simulate the SOON-TM:
+    // s_0: start state. Shift tape head by one and go to the simulated start
+    //  state. Needed because we start all strings with "beginning of tape"
+    //  symbol.
+    // s_1: If we reached beginning of tape symbol.
+    // s_2: If we're shifting all characters to the left, and the last character
+    // was a
+
+    // Since we construct our input to begin with the special beginning-of-tape
+    // symbol, we shift over one space before we begin simulating the SOON-TM.
+    trans.in_state = SS_TM_INITIAL_STATE;
+    trans.in_char = ss_tm_soon_symbol('[');
+    trans.out_state = simulated_start_state;
+    trans.out_char = ss_tm_soon_symbol('[');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Shift all input to the right by one, then return to the beginning, if we
+    // are at the beginning-of-tape character. Need a state to catch this for
+    // each of the normal states, except the halt state.
+    uint64_t shift_right_states_start = SS_TM_INITIAL_STATE + 100;
+
+    // Make sure to save our original state (one of the three simulated states,
+    // a, b, or c.
+    trans.in_state = simulated_start_state;
+    trans.in_char = ss_tm_soon_symbol('[');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.out_char = ss_tm_soon_symbol('a');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = simulated_start_state + 1;
+    trans.in_char = ss_tm_soon_symbol('[');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.out_char = ss_tm_soon_symbol('b');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = simulated_start_state + 2;
+    trans.in_char = ss_tm_soon_symbol('[');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.out_char = ss_tm_soon_symbol('c');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Moving right and we've saved a "["
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.in_char = ss_tm_soon_symbol('1');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('[');
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(']');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Moving right and we've saved a " "
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.in_char = ss_tm_soon_symbol('1');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(']');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Moving right and we've saved a "1"
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(' ');
+    trans.out_char = ss_tm_soon_symbol('1');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.in_char = ss_tm_soon_symbol('1');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.out_char = ss_tm_soon_symbol('1');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol('1');
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = shift_right_states_start + ss_tm_soon_symbol(']');
+    trans.out_char = ss_tm_soon_symbol('1');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Moving right and we've saved a "]"
+    // Stop moving right. Now we need to return to the saved state.
+    trans.in_state = shift_right_states_start + ss_tm_soon_symbol(']');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = shift_right_states_start + 50;
+    trans.out_char = ss_tm_soon_symbol(']');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // We've shifted everything to the right one character, now we are returning
+    // to the saved state.
+    trans.in_state = shift_right_states_start + 50;
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = shift_right_states_start + 50;
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + 50;
+    trans.in_char = ss_tm_soon_symbol('1');
+    trans.out_state = shift_right_states_start + 50;
+    trans.out_char = ss_tm_soon_symbol('1');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + 50;
+    trans.in_char = ss_tm_soon_symbol('a');
+    trans.out_state = simulated_start_state;
+    trans.out_char = ss_tm_soon_symbol('[');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + 50;
+    trans.in_char = ss_tm_soon_symbol('b');
+    trans.out_state = simulated_start_state + 1;
+    trans.out_char = ss_tm_soon_symbol('[');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = shift_right_states_start + 50;
+    trans.in_char = ss_tm_soon_symbol('c');
+    trans.out_state = simulated_start_state + 2;
+    trans.out_char = ss_tm_soon_symbol('[');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    // Now, similar if we need to shift the right bound character "]" over by
+    // one.
+    uint64_t new_char_on_left_start_state = SS_TM_INITIAL_STATE + 200;
+
+    trans.in_state = simulated_start_state;
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = new_char_on_left_start_state + ss_tm_soon_symbol('a');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = simulated_start_state + 1;
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = new_char_on_left_start_state + ss_tm_soon_symbol('b');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = simulated_start_state + 2;
+    trans.in_char = ss_tm_soon_symbol(']');
+    trans.out_state = new_char_on_left_start_state + ss_tm_soon_symbol('c');
+    trans.out_char = ss_tm_soon_symbol(' ');
+    trans.out_right = true;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = new_char_on_left_start_state + ss_tm_soon_symbol('a');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = simulated_start_state;
+    trans.out_char = ss_tm_soon_symbol(']');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = new_char_on_left_start_state + ss_tm_soon_symbol('b');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = simulated_start_state + 1;
+    trans.out_char = ss_tm_soon_symbol(']');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);
+
+    trans.in_state = new_char_on_left_start_state + ss_tm_soon_symbol('c');
+    trans.in_char = ss_tm_soon_symbol(' ');
+    trans.out_state = simulated_start_state + 2;
+    trans.out_char = ss_tm_soon_symbol(']');
+    trans.out_right = false;
+    ss_tm_soon_add(tm, trans, &e);    return e;
+}
+
+    enum ss_tm_err
+ss_tm_soon_add_verified_machine(
+    struct ss_tm *tm,
+    uint64_t simulated_start_state) {
+
+    // States are relative to simulated_start_state.
+    static const struct {
+        uint64_t in_state;
+        char in_char;
+        uint64_t out_state;
+        char out_char;
+        bool out_right;
+    } transitions[] = {
+        {0, ' ', 1, '1', false},
+        {0, '1', 2, '1', false},
+        {1, ' ', 2, '1', true},
+        {1, '1', 0, '1', false},
+        {2, ' ', 0, '1', false},
+        {2, '1', 0, '1', true}
+    };
+
+    enum ss_tm_err e = SS_TM_ERR_NO_ERROR;
+    size_t i;
+    for(i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++) {
+        struct ss_tm_transition trans;
+        trans.in_state = simulated_start_state + transitions[i].in_state;
+        trans.in_char = ss_tm_soon_symbol(transitions[i].in_char);
+        trans.out_state = simulated_start_state + transitions[i].out_state;
+        trans.out_char = ss_tm_soon_symbol(transitions[i].out_char);
+        trans.out_right = transitions[i].out_right;
+        ss_tm_soon_add(tm, trans, &e);
+    }
+    return e;
+}
@@ -0,0 +1,39 @@
+#ifndef ss_tm_soon_h
+#define ss_tm_soon_h
+
+#include "ss_tm.h"
+
+// The emulation that example.c runs its SOON-TM candidates on: a machine with
+// a one-way tape that simulates a 3-state, 2-symbol machine on a doubly
+// infinite one, by keeping the simulated tape between a '[' and a ']' and
+// shifting it right whenever the simulated head runs into the '['. The
+// simulated states are simulated_start_state, + 1 and + 2 (q_0, q_1, q_2);
+// the emulation itself uses states SS_TM_INITIAL_STATE + 100 to + 206, so
+// simulated_start_state must be past those.
+
+// ss_tm_soon_symbol's answer for a char the emulation doesn't use.
+#define SS_TM_SOON_NO_SYMBOL UINT64_MAX
+
+// The tape symbol for c: ' ' and '1' are the simulated machine's symbols, '['
+// and ']' bound its tape, and 'a'..'c' mark the state the simulated machine
+// was in while its tape is being shifted.
+    uint64_t
+ss_tm_soon_symbol(
+    char c);
+
+// Adds the emulation's transitions to tm, which must be between
+// ss_tm_init_begin and ss_tm_init_end. The simulated machine's transitions are
+// left to the caller. Stops at the first error and returns it.
+    enum ss_tm_err
+ss_tm_soon_add_emulation(
+    struct ss_tm *tm,
+    uint64_t simulated_start_state);
+
+// Adds the transitions of the simulated machine whose run example.c's
+// verifier prints.
+    enum ss_tm_err
+ss_tm_soon_add_verified_machine(
+    struct ss_tm *tm,
+    uint64_t simulated_start_state);
+
+#endif // #ifndef ss_tm_soon_h
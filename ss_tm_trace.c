@@ -0,0 +1,388 @@
+#include "ss_tm_trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char ss_tm_trace_magic[8] = {'S', 'S', 'T', 'M', 'T', 'R', 'C', '1'};
+
+enum ss_tm_trace_record_kind {
+    SS_TM_TRACE_STEP = 0,
+    SS_TM_TRACE_RUN = 1,
+    SS_TM_TRACE_KEYFRAME = 2,
+    SS_TM_TRACE_END = 3
+};
+
+    static void
+ss_tm_trace_write_varint(
+    FILE *f,
+    uint64_t v) {
+
+    while(v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+// Returns false if the varint runs past end.
+    static bool
+ss_tm_trace_read_varint(
+    const uint8_t **p,
+    const uint8_t *end,
+    uint64_t *out) {
+
+    uint64_t v = 0;
+    int shift;
+    for(shift = 0; shift < 64 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+    static void
+ss_tm_trace_flush_run(
+    struct ss_tm_trace_recorder *self) {
+
+    if(self->run_length == 1) {
+        ss_tm_trace_write_varint(self->f, (uint64_t)self->run_transition * 4 + SS_TM_TRACE_STEP);
+    } else if(self->run_length > 1) {
+        ss_tm_trace_write_varint(self->f, (uint64_t)self->run_transition * 4 + SS_TM_TRACE_RUN);
+        ss_tm_trace_write_varint(self->f, self->run_length);
+    }
+    self->run_length = 0;
+}
+
+    static void
+ss_tm_trace_write_keyframe(
+    struct ss_tm_trace_recorder *self,
+    struct ss_tm *tm) {
+
+    // Cells past both the head and the last non-blank cell are implied.
+    size_t num_cells = tm->tape_size;
+    while(num_cells > tm->tape_head + 1 && tm->tape[num_cells - 1] == 0)
+        num_cells--;
+
+    ss_tm_trace_write_varint(self->f, SS_TM_TRACE_KEYFRAME);
+    ss_tm_trace_write_varint(self->f, tm->steps);
+    ss_tm_trace_write_varint(self->f, tm->state);
+    ss_tm_trace_write_varint(self->f, tm->tape_head);
+    ss_tm_trace_write_varint(self->f, num_cells);
+    size_t i;
+    for(i = 0; i < num_cells; i++)
+        ss_tm_trace_write_varint(self->f, tm->tape[i]);
+    self->next_keyframe = tm->steps + self->keyframe_interval;
+}
+
+    enum ss_tm_err
+ss_tm_trace_begin(
+    struct ss_tm_trace_recorder *self,
+    FILE *f,
+    struct ss_tm *tm,
+    uint64_t keyframe_interval) {
+
+    if(!tm->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    self->f = f;
+    self->keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+    self->run_length = 0;
+
+    fwrite(ss_tm_trace_magic, 1, sizeof(ss_tm_trace_magic), f);
+    ss_tm_trace_write_varint(f, self->keyframe_interval);
+    ss_tm_trace_write_varint(f, tm->transitions_end);
+    ss_tm_trace_write_keyframe(self, tm);
+    return ferror(f) ? SS_TM_ERR_IO_FAILED : SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_trace_step(
+    struct ss_tm_trace_recorder *self,
+    struct ss_tm *tm) {
+
+    if(tm->simulation_started && tm->steps >= self->next_keyframe) {
+        ss_tm_trace_flush_run(self);
+        ss_tm_trace_write_keyframe(self, tm);
+    }
+
+    enum ss_tm_err e = ss_tm_simulation_step(tm);
+    if(e != SS_TM_ERR_NO_ERROR)
+        return e;
+
+    if(self->run_length > 0 && tm->last_transition == self->run_transition) {
+        self->run_length++;
+    } else {
+        ss_tm_trace_flush_run(self);
+        self->run_transition = tm->last_transition;
+        self->run_length = 1;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_trace_step_multiple(
+    struct ss_tm_trace_recorder *self,
+    struct ss_tm *tm,
+    uint64_t num_steps) {
+
+    uint64_t i;
+    for(i = 0; i < num_steps; i++) {
+        enum ss_tm_err e = ss_tm_trace_step(self, tm);
+        if(e != SS_TM_ERR_NO_ERROR)
+            return e;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_trace_end(
+    struct ss_tm_trace_recorder *self) {
+
+    ss_tm_trace_flush_run(self);
+    ss_tm_trace_write_varint(self->f, SS_TM_TRACE_END);
+    if(fflush(self->f) != 0 || ferror(self->f))
+        return SS_TM_ERR_IO_FAILED;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+// Skips over the keyframe whose kind varint has already been read.
+    static bool
+ss_tm_trace_skip_keyframe(
+    const uint8_t **p,
+    const uint8_t *end,
+    uint64_t *out_step) {
+
+    uint64_t state;
+    uint64_t head;
+    uint64_t num_cells;
+    if(!ss_tm_trace_read_varint(p, end, out_step) ||
+        !ss_tm_trace_read_varint(p, end, &state) ||
+        !ss_tm_trace_read_varint(p, end, &head) ||
+        !ss_tm_trace_read_varint(p, end, &num_cells)) {
+
+        return false;
+    }
+    uint64_t i;
+    uint64_t cell;
+    for(i = 0; i < num_cells; i++) {
+        if(!ss_tm_trace_read_varint(p, end, &cell))
+            return false;
+    }
+    return true;
+}
+
+    enum ss_tm_err
+ss_tm_trace_player_open(
+    struct ss_tm_trace_player *self,
+    const char *path,
+    const struct ss_tm *machine) {
+
+    if(!machine->init)
+        return SS_TM_ERR_MACHINE_NOT_INITIALIZED;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return SS_TM_ERR_IO_FAILED;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return SS_TM_ERR_IO_FAILED;
+    }
+    if((size_t)st.st_size < sizeof(ss_tm_trace_magic)) {
+        close(fd);
+        return SS_TM_ERR_BAD_FILE_FORMAT;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return SS_TM_ERR_IO_FAILED;
+
+    self->machine = machine;
+    self->data = (const uint8_t *)data;
+    self->data_size = st.st_size;
+    self->keyframes_end = 0;
+    self->keyframes = NULL;
+    self->num_steps = 0;
+    self->tape = NULL;
+    self->tape_size = 0;
+
+    // Index the keyframes and count the steps in one pass.
+    const uint8_t *p = self->data + sizeof(ss_tm_trace_magic);
+    const uint8_t *end = self->data + self->data_size;
+    uint64_t keyframe_interval;
+    uint64_t transitions_end;
+    enum ss_tm_err e = SS_TM_ERR_BAD_FILE_FORMAT;
+    if(memcmp(self->data, ss_tm_trace_magic, sizeof(ss_tm_trace_magic)) != 0 ||
+        !ss_tm_trace_read_varint(&p, end, &keyframe_interval) ||
+        !ss_tm_trace_read_varint(&p, end, &transitions_end) ||
+        transitions_end != machine->transitions_end) {
+
+        goto fail;
+    }
+
+    size_t keyframes_size = 16;
+    self->keyframes = (struct ss_tm_trace_keyframe *)malloc(
+        sizeof(struct ss_tm_trace_keyframe) * keyframes_size);
+    if(!self->keyframes) {
+        e = SS_TM_ERR_ALLOCATION_FAILED;
+        goto fail;
+    }
+
+    bool ended = false;
+    while(!ended) {
+        size_t offset = p - self->data;
+        uint64_t v;
+        if(!ss_tm_trace_read_varint(&p, end, &v))
+            goto fail;
+        uint64_t count = 1;
+        switch(v % 4) {
+            case SS_TM_TRACE_STEP:
+                self->num_steps += 1;
+                break;
+            case SS_TM_TRACE_RUN:
+                if(!ss_tm_trace_read_varint(&p, end, &count))
+                    goto fail;
+                self->num_steps += count;
+                break;
+            case SS_TM_TRACE_KEYFRAME:
+                if(self->keyframes_end == keyframes_size) {
+                    struct ss_tm_trace_keyframe *keyframes = (struct ss_tm_trace_keyframe *)realloc(
+                        self->keyframes,
+                        sizeof(struct ss_tm_trace_keyframe) * keyframes_size * 2);
+                    if(!keyframes) {
+                        e = SS_TM_ERR_ALLOCATION_FAILED;
+                        goto fail;
+                    }
+                    self->keyframes = keyframes;
+                    keyframes_size *= 2;
+                }
+                self->keyframes[self->keyframes_end].offset = offset;
+                if(!ss_tm_trace_skip_keyframe(&p, end, &self->keyframes[self->keyframes_end].step))
+                    goto fail;
+                self->num_steps = self->keyframes[self->keyframes_end].step;
+                self->keyframes_end++;
+                break;
+            case SS_TM_TRACE_END:
+                ended = true;
+                break;
+        }
+    }
+    if(self->keyframes_end == 0)
+        goto fail;
+
+    return ss_tm_trace_player_seek(self, self->keyframes[0].step);
+
+fail:
+    free(self->keyframes);
+    munmap(data, self->data_size);
+    return e;
+}
+
+    static bool
+ss_tm_trace_player_reserve(
+    struct ss_tm_trace_player *self,
+    size_t num_cells) {
+
+    if(num_cells <= self->tape_size)
+        return true;
+    size_t tape_size = self->tape_size ? self->tape_size : 16;
+    while(tape_size < num_cells)
+        tape_size *= 2;
+    uint64_t *tape = (uint64_t *)realloc(self->tape, tape_size * sizeof(uint64_t));
+    if(!tape)
+        return false;
+    memset(tape + self->tape_size, 0x00, (tape_size - self->tape_size) * sizeof(uint64_t));
+    self->tape = tape;
+    self->tape_size = tape_size;
+    return true;
+}
+
+    enum ss_tm_err
+ss_tm_trace_player_seek(
+    struct ss_tm_trace_player *self,
+    uint64_t step) {
+
+    if(step < self->keyframes[0].step || step > self->num_steps)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    // The last keyframe at or before step.
+    size_t lo = 0;
+    size_t hi = self->keyframes_end;
+    while(hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(self->keyframes[mid].step <= step)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const uint8_t *p = self->data + self->keyframes[lo].offset;
+    const uint8_t *end = self->data + self->data_size;
+    uint64_t v = 0;
+    uint64_t head = 0;
+    uint64_t num_cells = 0;
+    // The file was fully validated when opened, so reads can't fail.
+    ss_tm_trace_read_varint(&p, end, &v);
+    ss_tm_trace_read_varint(&p, end, &self->step);
+    ss_tm_trace_read_varint(&p, end, &self->state);
+    ss_tm_trace_read_varint(&p, end, &head);
+    ss_tm_trace_read_varint(&p, end, &num_cells);
+    if(!ss_tm_trace_player_reserve(self, num_cells > head ? num_cells : head + 1))
+        return SS_TM_ERR_ALLOCATION_FAILED;
+    memset(self->tape, 0x00, self->tape_size * sizeof(uint64_t));
+    size_t i;
+    for(i = 0; i < num_cells; i++)
+        ss_tm_trace_read_varint(&p, end, &self->tape[i]);
+    self->tape_head = head;
+
+    const struct ss_tm_transition *transitions = self->machine->transitions;
+    size_t transitions_end = self->machine->transitions_end;
+    while(self->step < step) {
+        uint64_t count = 1;
+        ss_tm_trace_read_varint(&p, end, &v);
+        if(v % 4 == SS_TM_TRACE_RUN)
+            ss_tm_trace_read_varint(&p, end, &count);
+        if(count > step - self->step)
+            count = step - self->step;
+
+        uint64_t id = v / 4;
+        if(id >= transitions_end) {
+            self->state = SS_TM_REJECT_STATE;
+            self->step += count;
+            continue;
+        }
+        const struct ss_tm_transition *t = &transitions[id];
+        uint64_t j;
+        for(j = 0; j < count; j++) {
+            self->state = t->out_state;
+            self->tape[self->tape_head] = t->out_char;
+            if(t->out_right) {
+                self->tape_head++;
+                if(!ss_tm_trace_player_reserve(self, self->tape_head + 1))
+                    return SS_TM_ERR_ALLOCATION_FAILED;
+            } else {
+                self->tape_head--;
+            }
+        }
+        self->step += count;
+    }
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_trace_player_close(
+    struct ss_tm_trace_player *self) {
+
+    free(self->keyframes);
+    free(self->tape);
+    munmap((void *)self->data, self->data_size);
+    return SS_TM_ERR_NO_ERROR;
+}
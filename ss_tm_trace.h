@@ -0,0 +1,105 @@
+#ifndef ss_tm_trace_h
+#define ss_tm_trace_h
+
+#include "ss_tm.h"
+
+#include <stdio.h>
+
+// Compact binary traces of a simulation. The recorder steps a machine and
+// writes which transition each step took, run-length encoding repeats of the
+// same transition, so a step usually costs a byte or less. Every
+// keyframe_interval steps it also writes a keyframe holding the whole
+// configuration. The player finds the keyframe at or before a requested step
+// and replays the transitions from there.
+//
+// The file is an 8-byte magic ("SSTMTRC1") followed by LEB128 varints. The
+// first three are the keyframe interval, the machine's transitions_end (to
+// catch replaying against the wrong machine), and a keyframe. Each record
+// then starts with a varint v, where v % 4 is its kind:
+//   0: one step taking transition v / 4
+//   1: a run of steps all taking transition v / 4; the count follows
+//   2: a keyframe: step, state, head, cell count, then the cells
+//   3: the end of the trace
+// Transition transitions_end stands for a step that rejected because no
+// transition matched.
+
+struct ss_tm_trace_recorder {
+    FILE *f;
+    uint64_t keyframe_interval;
+    uint64_t next_keyframe;
+    // The run of identical transitions not yet written.
+    size_t run_transition;
+    uint64_t run_length;
+};
+
+// Writes the trace header and a keyframe of tm, which must have a started
+// simulation, to f. f stays owned by the caller.
+    enum ss_tm_err
+ss_tm_trace_begin(
+    struct ss_tm_trace_recorder *self,
+    FILE *f,
+    struct ss_tm *tm,
+    uint64_t keyframe_interval);
+
+// Steps tm and records the step. Errors from ss_tm_simulation_step are
+// passed through, and nothing is recorded for them.
+    enum ss_tm_err
+ss_tm_trace_step(
+    struct ss_tm_trace_recorder *self,
+    struct ss_tm *tm);
+
+    enum ss_tm_err
+ss_tm_trace_step_multiple(
+    struct ss_tm_trace_recorder *self,
+    struct ss_tm *tm,
+    uint64_t num_steps);
+
+// Writes any pending run and the end marker. Doesn't close f.
+    enum ss_tm_err
+ss_tm_trace_end(
+    struct ss_tm_trace_recorder *self);
+
+struct ss_tm_trace_keyframe {
+    uint64_t step;
+    // Offset of the keyframe's record in the trace.
+    size_t offset;
+};
+
+struct ss_tm_trace_player {
+    const struct ss_tm *machine;
+    // The trace, mapped read-only.
+    const uint8_t *data;
+    size_t data_size;
+    struct ss_tm_trace_keyframe *keyframes;
+    size_t keyframes_end;
+    // Number of steps in the trace.
+    uint64_t num_steps;
+
+    // The configuration at step.
+    uint64_t *tape;
+    size_t tape_size;
+    size_t tape_head;
+    uint64_t state;
+    uint64_t step;
+};
+
+// machine must be the initialized machine the trace was recorded from, and
+// must outlive the player.
+    enum ss_tm_err
+ss_tm_trace_player_open(
+    struct ss_tm_trace_player *self,
+    const char *path,
+    const struct ss_tm *machine);
+
+// Reconstructs the configuration after the given number of steps. Fails with
+// SS_TM_ERR_OUT_OF_RANGE if the trace has fewer steps.
+    enum ss_tm_err
+ss_tm_trace_player_seek(
+    struct ss_tm_trace_player *self,
+    uint64_t step);
+
+    enum ss_tm_err
+ss_tm_trace_player_close(
+    struct ss_tm_trace_player *self);
+
+#endif // #ifndef ss_tm_trace_h
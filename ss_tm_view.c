@@ -0,0 +1,175 @@
+#include "ss_tm_view.h"
+
+    static bool
+ss_tm_view_stale(
+    const struct ss_tm_tape_view *self) {
+
+    return !self->tm->simulation_started ||
+        self->tm->tape_generation != self->generation;
+}
+
+    uint64_t
+ss_tm_hash_append(
+    uint64_t hash,
+    uint64_t cell) {
+
+    return ss_tm_hash_reduce(
+        (unsigned __int128)hash * SS_TM_HASH_BASE + ss_tm_hash_digit(cell));
+}
+
+// base to the power exponent, modulo SS_TM_HASH_MODULUS.
+    static uint64_t
+ss_tm_hash_pow(
+    uint64_t base,
+    uint64_t exponent) {
+
+    uint64_t result = 1;
+    while(exponent > 0) {
+        if(exponent & 1)
+            result = ss_tm_hash_mul(result, base);
+        base = ss_tm_hash_mul(base, base);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+    uint64_t
+ss_tm_hash_power(
+    size_t width) {
+
+    return ss_tm_hash_pow(SS_TM_HASH_BASE, width);
+}
+
+// hash with count blanks appended. Their digits are all 1, so they add
+// base^(count - 1) + ... + 1 = (base^count - 1) / (base - 1), the division
+// being by the inverse of base - 1, which is (base - 1)^(modulus - 2).
+    static uint64_t
+ss_tm_hash_append_blanks(
+    uint64_t hash,
+    size_t count) {
+
+    uint64_t power = ss_tm_hash_power(count);
+    uint64_t sum = ss_tm_hash_mul(
+        power == 0 ? SS_TM_HASH_MODULUS - 1 : power - 1,
+        ss_tm_hash_pow(SS_TM_HASH_BASE - 1, SS_TM_HASH_MODULUS - 2));
+    return ss_tm_hash_reduce((unsigned __int128)hash * power + sum);
+}
+
+    uint64_t
+ss_tm_hash_roll(
+    uint64_t hash,
+    uint64_t cell_leaving,
+    uint64_t cell_entering,
+    uint64_t power) {
+
+    uint64_t appended = ss_tm_hash_append(hash, cell_entering);
+    uint64_t leaving = ss_tm_hash_reduce((unsigned __int128)ss_tm_hash_digit(cell_leaving) * power);
+    return appended >= leaving ?
+        appended - leaving : appended + SS_TM_HASH_MODULUS - leaving;
+}
+
+    enum ss_tm_err
+ss_tm_view_begin(
+    struct ss_tm_tape_view *self,
+    const struct ss_tm *tm) {
+
+    if(!tm->simulation_started)
+        return SS_TM_ERR_UNSTARTED_SIMULATION;
+
+    // Blanks written over the end of the used cells are trimmed. That's at
+    // most the cells written since they were blanked, not the whole tape.
+    size_t end = tm->tape_used;
+    while(end > 0 && tm->tape[end - 1] == 0)
+        end--;
+
+    self->tm = tm;
+    self->generation = tm->tape_generation;
+    self->end = end;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_view_chunk(
+    const struct ss_tm_tape_view *self,
+    size_t position,
+    size_t max_cells,
+    const uint64_t **out_cells,
+    size_t *out_num_cells) {
+
+    if(ss_tm_view_stale(self))
+        return SS_TM_ERR_STALE_VIEW;
+    if(position >= self->end)
+        return SS_TM_ERR_OUT_OF_RANGE;
+
+    size_t num_cells = self->end - position;
+    if(num_cells > max_cells)
+        num_cells = max_cells;
+    *out_cells = self->tm->tape + position;
+    *out_num_cells = num_cells;
+    return SS_TM_ERR_NO_ERROR;
+}
+
+    enum ss_tm_err
+ss_tm_view_export_rle(
+    const struct ss_tm_tape_view *self,
+    size_t begin,
+    size_t end,
+    struct ss_tm_tape_run *out_runs,
+    size_t runs_capacity,
+    size_t *out_num_runs) {
+
+    if(ss_tm_view_stale(self))
+        return SS_TM_ERR_STALE_VIEW;
+
+    const uint64_t *tape = self->tm->tape;
+    size_t tape_end = end < self->tm->tape_size ? end : self->tm->tape_size;
+    size_t num_runs = 0;
+    size_t i = begin;
+    while(i < end) {
+        uint64_t symbol;
+        size_t run_end;
+        if(i < tape_end) {
+            symbol = tape[i];
+            run_end = i + 1;
+            while(run_end < tape_end && tape[run_end] == symbol)
+                run_end++;
+            // Blanks continue past the end of the tape.
+            if(run_end == tape_end && symbol == 0)
+                run_end = end;
+        } else {
+            symbol = 0;
+            run_end = end;
+        }
+        if(num_runs < runs_capacity) {
+            out_runs[num_runs].symbol = symbol;
+            out_runs[num_runs].length = run_end - i;
+        }
+        num_runs++;
+        i = run_end;
+    }
+
+    *out_num_runs = num_runs;
+    return num_runs <= runs_capacity ? SS_TM_ERR_NO_ERROR : SS_TM_ERR_OUT_OF_RANGE;
+}
+
+    enum ss_tm_err
+ss_tm_view_hash(
+    const struct ss_tm_tape_view *self,
+    size_t begin,
+    size_t end,
+    uint64_t *out_hash) {
+
+    if(ss_tm_view_stale(self))
+        return SS_TM_ERR_STALE_VIEW;
+
+    const uint64_t *tape = self->tm->tape;
+    size_t tape_end = end < self->tm->tape_size ? end : self->tm->tape_size;
+    uint64_t hash = 0;
+    size_t i;
+    for(i = begin; i < tape_end; i++)
+        hash = ss_tm_hash_append(hash, tape[i]);
+    if(i < end)
+        hash = ss_tm_hash_append_blanks(hash, end - i);
+    *out_hash = hash;
+    return SS_TM_ERR_NO_ERROR;
+}
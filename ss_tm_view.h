@@ -0,0 +1,89 @@
+#ifndef ss_tm_view_h
+#define ss_tm_view_h
+
+#include "ss_tm.h"
+#include "ss_tm_hash.h"
+
+// Read-only views of a machine's tape that don't copy it. A view records the
+// tape's generation when it was made; once the tape is reallocated or a new
+// simulation starts, every call on the view fails with
+// SS_TM_ERR_STALE_VIEW instead of reading freed memory. Stepping the machine
+// otherwise leaves a view valid, and it sees the cells' current contents.
+//
+// Positions past the end of the tape read as blank, so any range may be
+// asked for.
+
+struct ss_tm_tape_view {
+    const struct ss_tm *tm;
+    uint64_t generation;
+    // One past the last non-blank cell when the view was made.
+    size_t end;
+};
+
+// A run of length equal cells.
+struct ss_tm_tape_run {
+    uint64_t symbol;
+    uint64_t length;
+};
+
+    enum ss_tm_err
+ss_tm_view_begin(
+    struct ss_tm_tape_view *self,
+    const struct ss_tm *tm);
+
+// Gets the cells from position on, at most max_cells of them and never past
+// the view's end, in place. Fails with SS_TM_ERR_OUT_OF_RANGE once position
+// reaches the end, so the non-blank extent can be walked with
+//   for(p = 0; ss_tm_view_chunk(&v, p, n, &cells, &num) == SS_TM_ERR_NO_ERROR; p += num)
+    enum ss_tm_err
+ss_tm_view_chunk(
+    const struct ss_tm_tape_view *self,
+    size_t position,
+    size_t max_cells,
+    const uint64_t **out_cells,
+    size_t *out_num_cells);
+
+// Run-length encodes the cells in [begin, end). out_num_runs receives the
+// number of runs. If that's more than runs_capacity, only the first
+// runs_capacity are written and the call fails with SS_TM_ERR_OUT_OF_RANGE;
+// out_runs may be NULL with runs_capacity 0 to just count them.
+    enum ss_tm_err
+ss_tm_view_export_rle(
+    const struct ss_tm_tape_view *self,
+    size_t begin,
+    size_t end,
+    struct ss_tm_tape_run *out_runs,
+    size_t runs_capacity,
+    size_t *out_num_runs);
+
+// Hashes the cells in [begin, end), as ss_tm_hash.h describes: the hash of
+// its cells appended in order to 0, where appending is hash * base + digit.
+// Blanks past the end of the tape take time logarithmic in their number.
+    enum ss_tm_err
+ss_tm_view_hash(
+    const struct ss_tm_tape_view *self,
+    size_t begin,
+    size_t end,
+    uint64_t *out_hash);
+
+// Building blocks for rolling a hash along the tape. For a window of width w
+// hashed to hash, the window one cell to the right hashes to
+//   ss_tm_hash_roll(hash, cell_leaving, cell_entering, ss_tm_hash_power(w))
+    uint64_t
+ss_tm_hash_append(
+    uint64_t hash,
+    uint64_t cell);
+
+// Returns SS_TM_HASH_BASE to the power width.
+    uint64_t
+ss_tm_hash_power(
+    size_t width);
+
+    uint64_t
+ss_tm_hash_roll(
+    uint64_t hash,
+    uint64_t cell_leaving,
+    uint64_t cell_entering,
+    uint64_t power);
+
+#endif // #ifndef ss_tm_view_h